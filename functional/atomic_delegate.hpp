@@ -0,0 +1,257 @@
+#pragma once
+#ifndef ATOMIC_DELEGATE_HPP
+# define ATOMIC_DELEGATE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "impl_fast_delegate.hpp"
+
+/*
+ * A delegate that can be replaced while other threads call it.
+ *
+ *   atomic_delegate<void(request&)> route(round_robin);
+ *   route(req);                  // any number of threads
+ *   route.store(least_loaded);   // any thread, any time
+ *
+ * The target is a delegate in its own heap node, published through one
+ * atomic pointer. Calling announces the current epoch for the calling
+ * thread, loads the pointer and calls the target: a handful of plain
+ * loads and stores with no loop or lock. A replaced node is retired
+ * and freed once every thread calling at the time has moved past its
+ * epoch.
+ */
+
+namespace detail {
+namespace epoch {
+
+  constexpr std::uint64_t idle = ~std::uint64_t(0);
+
+  // Per thread. Records are never freed, those of exited threads
+  // are reused.
+  struct reader_record
+  {
+    std::atomic<std::uint64_t> epoch{idle};
+    std::atomic<bool> in_use{true};
+    unsigned nesting = 0; // only touched by the owning thread
+    reader_record* next = nullptr;
+    // Keeps the next record off the cache line of epoch
+    char pad_[64];
+  };
+
+  class domain
+  {
+  public:
+    using deleter_type = void (*)(void*);
+
+    static domain& instance()
+    {
+      // Never destroyed: threads may exit during static destruction
+      static domain* d = new domain;
+      return *d;
+    }
+
+    reader_record* acquire_record()
+    {
+      for (auto r = records_.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->in_use.load(std::memory_order_relaxed) &&
+            r->in_use.compare_exchange_strong(expected, true,
+              std::memory_order_acquire)) {
+          return r;
+        }
+      }
+      auto r = new reader_record;
+      r->next = records_.load(std::memory_order_relaxed);
+      while (!records_.compare_exchange_weak(r->next, r,
+               std::memory_order_release, std::memory_order_relaxed))
+        ;
+      return r;
+    }
+
+    void release_record(reader_record* r) noexcept
+    {
+      r->in_use.store(false, std::memory_order_release);
+    }
+
+    void enter(reader_record& r) noexcept
+    {
+      if (!r.nesting++) {
+        // seq_cst orders this before loading the protected pointer
+        r.epoch.store(epoch_.load(std::memory_order_acquire));
+      }
+    }
+
+    void leave(reader_record& r) noexcept
+    {
+      if (!--r.nesting) r.epoch.store(idle, std::memory_order_release);
+    }
+
+    // p must already be unreachable for new readers
+    void retire(void* p, deleter_type deleter)
+    {
+      std::vector<retired> ready;
+      {
+        std::lock_guard<std::mutex> lk(mtx_);
+        retired_.push_back({p, deleter, epoch_.load(std::memory_order_relaxed)});
+        try_advance();
+        auto const e = epoch_.load(std::memory_order_relaxed);
+        auto it = retired_.begin();
+        for (auto& r: retired_) {
+          if (r.epoch + 2 <= e) ready.push_back(r);
+          else *it++ = r;
+        }
+        retired_.erase(it, retired_.end());
+      }
+      // Outside the lock, deleters may retire in turn
+      for (auto& r: ready) r.deleter(r.p);
+    }
+
+  private:
+    struct retired
+    {
+      void* p;
+      deleter_type deleter;
+      std::uint64_t epoch;
+    };
+
+    // Moves to the next epoch if every thread inside a call has
+    // announced the current one
+    void try_advance() noexcept
+    {
+      auto const e = epoch_.load(std::memory_order_relaxed);
+      for (auto r = records_.load(std::memory_order_acquire); r; r = r->next) {
+        auto const re = r->epoch.load();
+        if (re != idle && re != e) return;
+      }
+      epoch_.store(e + 1, std::memory_order_release);
+    }
+
+    std::atomic<std::uint64_t> epoch_{0};
+    std::atomic<reader_record*> records_{nullptr};
+
+    std::mutex mtx_;
+    std::vector<retired> retired_;
+  };
+
+  struct record_handle
+  {
+    record_handle(): record(domain::instance().acquire_record()) {}
+    ~record_handle() { domain::instance().release_record(record); }
+
+    reader_record* record;
+  };
+
+  inline reader_record& local_record()
+  {
+    static thread_local record_handle h;
+    return *h.record;
+  }
+
+  class guard
+  {
+  public:
+    guard() noexcept : record_(local_record())
+    {
+      domain::instance().enter(record_);
+    }
+
+    ~guard() { domain::instance().leave(record_); }
+
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+  private:
+    reader_record& record_;
+  };
+
+} // namespace epoch
+} // namespace detail
+
+template <typename T> class atomic_delegate;
+
+template <class R, class ...A>
+class atomic_delegate<R (A...)>
+{
+public:
+  using delegate_type = delegate<R (A...)>;
+
+  atomic_delegate() = default;
+
+  atomic_delegate(delegate_type d) : target_(make_node(::std::move(d)))
+  {
+  }
+
+  atomic_delegate(atomic_delegate const&) = delete;
+
+  atomic_delegate& operator=(atomic_delegate const&) = delete;
+
+  // No thread may be calling it any more
+  ~atomic_delegate()
+  {
+    delete target_.load(::std::memory_order_relaxed);
+  }
+
+  // Threads already calling the old target finish with it
+  void store(delegate_type d)
+  {
+    auto const old(target_.exchange(make_node(::std::move(d))));
+
+    if (old)
+    {
+      detail::epoch::domain::instance().retire(old, delete_node);
+    }
+  }
+
+  atomic_delegate& operator=(delegate_type d)
+  {
+    store(::std::move(d));
+
+    return *this;
+  }
+
+  // A copy of the current target
+  delegate_type load() const
+  {
+    detail::epoch::guard const g;
+
+    auto const node(target_.load());
+
+    return node ? *node : delegate_type();
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return target_.load(::std::memory_order_relaxed);
+  }
+
+  R operator()(A... args) const
+  {
+    detail::epoch::guard const g;
+
+    auto const node(target_.load());
+
+    assert(node);
+
+    return (*node)(::std::forward<A>(args)...);
+  }
+
+private:
+  ::std::atomic<delegate_type*> target_{nullptr};
+
+  static delegate_type* make_node(delegate_type&& d)
+  {
+    return d ? new delegate_type(::std::move(d)) : nullptr;
+  }
+
+  static void delete_node(void* const p)
+  {
+    delete static_cast<delegate_type*>(p);
+  }
+};
+
+#endif // ATOMIC_DELEGATE_HPP
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef DELEGATE_AWAITABLE_HPP
+# define DELEGATE_AWAITABLE_HPP
+
+#include <atomic>
+#include <coroutine>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "impl_fast_delegate.hpp"
+
+// C++20. Awaits an operation that reports completion through a
+// delegate<void(T)> callback:
+//
+//   int n = co_await on_completion<int>(
+//     [&](delegate<void(int)> done) { sock.async_read(buf, done); });
+//
+// The awaitable, result slot included, lives in the coroutine frame.
+// The callback handed to the operation is made with from<>(), so it
+// points at the awaitable and allocates nothing; calling it stores the
+// result and resumes the coroutine. The callback may be called from
+// any thread, and before the initiating function returns.
+
+template <typename T, typename Initiate>
+class delegate_awaitable
+{
+public:
+  using callback_type = delegate<void (T)>;
+
+  explicit delegate_awaitable(Initiate initiate) :
+    initiate_(std::move(initiate))
+  {
+  }
+
+  delegate_awaitable(delegate_awaitable const&) = delete;
+  delegate_awaitable& operator=(delegate_awaitable const&) = delete;
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> const h)
+  {
+    handle_ = h;
+    initiate_(callback_type::template from<delegate_awaitable,
+      &delegate_awaitable::complete>(*this));
+    // Completed already: carry on without suspending
+    return state_.exchange(suspended, std::memory_order_acq_rel) != done;
+  }
+
+  T await_resume() { return std::move(*result_); }
+
+private:
+  enum state_type : unsigned char { initiating, suspended, done };
+
+  void complete(T result)
+  {
+    result_.emplace(std::move(result));
+    if (state_.exchange(done, std::memory_order_acq_rel) == suspended) {
+      handle_.resume();
+    }
+  }
+
+  Initiate initiate_;
+  std::coroutine_handle<> handle_;
+  std::atomic<state_type> state_{initiating};
+  std::optional<T> result_;
+};
+
+template <typename T, typename Initiate>
+delegate_awaitable<T, std::decay_t<Initiate>> on_completion(Initiate&& initiate)
+{
+  return delegate_awaitable<T, std::decay_t<Initiate>>(
+    std::forward<Initiate>(initiate));
+}
+
+#endif // DELEGATE_AWAITABLE_HPP
@@ -0,0 +1,538 @@
+#pragma once
+#ifndef DELEGATE_SET_HPP
+# define DELEGATE_SET_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#include "impl_fast_delegate.hpp"
+
+/*
+ * Flat open addressing containers keyed by delegate.
+ *
+ *   delegate_set<void(event const&)> handlers;
+ *   handlers.insert(delegate<void(event const&)>::from<W, &W::on>(w));
+ *
+ *   delegate_map<void(event const&), int> priority;
+ *   priority[d] = 3;
+ *
+ * Elements live in one array next to an array of control bytes, one
+ * per slot: empty, deleted, or 7 bits of the hash of a full slot.
+ * Lookup hashes once, then compares the control bytes of 16 slots at a
+ * time (SSE2 when available) and only looks at elements whose 7 bits
+ * match. Nothing is allocated per element.
+ *
+ * Keys compare and hash like delegate::operator== and std::hash: by
+ * target object and stub, or by stub and functor bytes for a functor
+ * stored inline. Copies and moves of a delegate therefore find the
+ * same element, and the table may move its elements when it grows.
+ */
+
+namespace detail {
+namespace flat {
+
+  using ctrl_t = signed char;
+
+  // Full slots hold h2 in 0 .. 127, the other states have the sign bit
+  constexpr ctrl_t empty = -128;
+  constexpr ctrl_t deleted = -2;
+
+  constexpr std::size_t group_width = 16;
+
+  inline std::size_t h1(std::size_t const hash) noexcept { return hash >> 7; }
+
+  inline ctrl_t h2(std::size_t const hash) noexcept
+  {
+    return static_cast<ctrl_t>(hash & 0x7f);
+  }
+
+  // Bit i is set for each control byte i of a group that matches
+  using bitmask = std::uint32_t;
+
+  inline unsigned lowest_bit(bitmask const m) noexcept
+  {
+    return __builtin_ctz(m);
+  }
+
+  class group
+  {
+  public:
+#ifdef __SSE2__
+    explicit group(const ctrl_t* p) noexcept :
+      ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)))
+    {}
+
+    bitmask match(ctrl_t const h) const noexcept
+    {
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), ctrl_));
+    }
+
+    bitmask match_empty() const noexcept { return match(empty); }
+
+    // Empty or deleted, the bytes with the sign bit set
+    bitmask match_free() const noexcept
+    {
+      return _mm_movemask_epi8(ctrl_);
+    }
+
+  private:
+    __m128i ctrl_;
+#else
+    explicit group(const ctrl_t* p) noexcept : ctrl_(p) {}
+
+    bitmask match(ctrl_t const h) const noexcept
+    {
+      bitmask m = 0;
+      for (std::size_t i = 0; i < group_width; ++i) {
+        if (ctrl_[i] == h) m |= bitmask(1) << i;
+      }
+      return m;
+    }
+
+    bitmask match_empty() const noexcept { return match(empty); }
+
+    bitmask match_free() const noexcept
+    {
+      bitmask m = 0;
+      for (std::size_t i = 0; i < group_width; ++i) {
+        if (ctrl_[i] < 0) m |= bitmask(1) << i;
+      }
+      return m;
+    }
+
+  private:
+    const ctrl_t* ctrl_;
+#endif
+  };
+
+  // Policy: key_type, value_type and key(value)
+  template <typename Policy, typename Hash, typename KeyEqual>
+  class table
+  {
+  public:
+    using key_type = typename Policy::key_type;
+    using value_type = typename Policy::value_type;
+
+    static constexpr std::size_t npos = ~std::size_t(0);
+
+    table() = default;
+
+    table(table&& other) noexcept :
+      ctrl_(other.ctrl_), slots_(other.slots_), capacity_(other.capacity_),
+      size_(other.size_), growth_left_(other.growth_left_)
+    {
+      other.ctrl_ = nullptr;
+      other.slots_ = nullptr;
+      other.capacity_ = other.size_ = other.growth_left_ = 0;
+    }
+
+    table& operator=(table&& other) noexcept
+    {
+      table tmp(std::move(other));
+      swap(tmp);
+      return *this;
+    }
+
+    table(const table&) = delete;
+    table& operator=(const table&) = delete;
+
+    ~table()
+    {
+      destroy_all();
+      release(ctrl_, slots_);
+    }
+
+    void swap(table& other) noexcept
+    {
+      std::swap(ctrl_, other.ctrl_);
+      std::swap(slots_, other.slots_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(size_, other.size_);
+      std::swap(growth_left_, other.growth_left_);
+    }
+
+    std::size_t size() const noexcept { return size_; }
+
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    bool full(std::size_t const i) const noexcept { return ctrl_[i] >= 0; }
+
+    value_type& slot(std::size_t const i) noexcept { return slots_[i]; }
+
+    const value_type& slot(std::size_t const i) const noexcept
+    {
+      return slots_[i];
+    }
+
+    std::size_t find(const key_type& k) const noexcept
+    {
+      return capacity_ ? find(k, Hash()(k)) : npos;
+    }
+
+    // Returns the slot of k and whether it was inserted. make(void*)
+    // constructs the value in place.
+    template <typename Make>
+    std::pair<std::size_t, bool> find_or_insert(const key_type& k, Make make)
+    {
+      auto const hash = Hash()(k);
+      if (capacity_) {
+        auto const i = find(k, hash);
+        if (i != npos) return {i, false};
+      }
+      if (!growth_left_) grow();
+      auto const i = find_free(hash);
+      make(static_cast<void*>(slots_ + i));
+      // Keys made from k must hash like k
+      assert(Hash()(Policy::key(slots_[i])) == hash);
+
+      if (ctrl_[i] == empty) --growth_left_;
+      ctrl_[i] = h2(hash);
+      ++size_;
+      return {i, true};
+    }
+
+    void erase_at(std::size_t const i) noexcept
+    {
+      slots_[i].~value_type();
+      --size_;
+      // Probing never went past a group that has an empty slot
+      if (group(ctrl_ + (i & ~(group_width - 1))).match_empty()) {
+        ctrl_[i] = empty;
+        ++growth_left_;
+      }
+      else {
+        ctrl_[i] = deleted;
+      }
+    }
+
+    void clear() noexcept
+    {
+      destroy_all();
+      for (std::size_t i = 0; i < capacity_; ++i) ctrl_[i] = empty;
+      size_ = 0;
+      growth_left_ = max_load(capacity_);
+    }
+
+    void reserve(std::size_t const n)
+    {
+      auto cap = capacity_ ? capacity_ : group_width;
+      while (max_load(cap) < n) cap *= 2;
+      if (cap != capacity_) rehash(cap);
+    }
+
+  private:
+    ctrl_t* ctrl_ = nullptr;
+    value_type* slots_ = nullptr;
+    // A power of two, and a multiple of the group width
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    // Empty slots that may still be filled before rehashing
+    std::size_t growth_left_ = 0;
+
+    static std::size_t max_load(std::size_t const cap) noexcept
+    {
+      return cap - cap / 8;
+    }
+
+    // Groups are probed quadratically, starting from the one h1 picks
+    std::size_t find(const key_type& k, std::size_t const hash) const noexcept
+    {
+      auto const groups_mask = capacity_ / group_width - 1;
+      auto g = h1(hash) & groups_mask;
+      for (std::size_t step = 1; ; ++step) {
+        auto const base = g * group_width;
+        group const grp(ctrl_ + base);
+        for (auto m = grp.match(h2(hash)); m; m &= m - 1) {
+          auto const i = base + lowest_bit(m);
+          if (KeyEqual()(Policy::key(slots_[i]), k)) return i;
+        }
+        if (grp.match_empty()) return npos;
+        g = (g + step) & groups_mask;
+      }
+    }
+
+    std::size_t find_free(std::size_t const hash) const noexcept
+    {
+      auto const groups_mask = capacity_ / group_width - 1;
+      auto g = h1(hash) & groups_mask;
+      for (std::size_t step = 1; ; ++step) {
+        auto const base = g * group_width;
+        if (auto const m = group(ctrl_ + base).match_free()) {
+          return base + lowest_bit(m);
+        }
+        g = (g + step) & groups_mask;
+      }
+    }
+
+    void grow()
+    {
+      // Mostly deleted slots: clean up at the same size
+      if (capacity_ && size_ <= max_load(capacity_) / 2) rehash(capacity_);
+      else rehash(capacity_ ? capacity_ * 2 : group_width);
+    }
+
+    // Value moves are expected not to throw, nor to change the hash
+    // of the key
+    void rehash(std::size_t const cap)
+    {
+      auto const ctrl = static_cast<ctrl_t*>(::operator new(cap));
+      value_type* slots;
+      try {
+        slots = static_cast<value_type*>(::operator new(cap * sizeof(value_type)));
+      }
+      catch (...) {
+        ::operator delete(ctrl);
+        throw;
+      }
+      for (std::size_t i = 0; i < cap; ++i) ctrl[i] = empty;
+
+      auto const old_ctrl = ctrl_;
+      auto const old_slots = slots_;
+      auto const old_capacity = capacity_;
+      ctrl_ = ctrl;
+      slots_ = slots;
+      capacity_ = cap;
+      growth_left_ = max_load(cap) - size_;
+
+      for (std::size_t i = 0; i < old_capacity; ++i) {
+        if (old_ctrl[i] < 0) continue;
+        auto const hash = Hash()(Policy::key(old_slots[i]));
+        auto const j = find_free(hash);
+        new (slots_ + j) value_type(std::move(old_slots[i]));
+        old_slots[i].~value_type();
+        ctrl_[j] = h2(hash);
+      }
+      release(old_ctrl, old_slots);
+    }
+
+    void destroy_all() noexcept
+    {
+      for (std::size_t i = 0; i < capacity_; ++i) {
+        if (full(i)) slots_[i].~value_type();
+      }
+    }
+
+    static void release(ctrl_t* const ctrl, value_type* const slots) noexcept
+    {
+      ::operator delete(ctrl);
+      ::operator delete(slots);
+    }
+  };
+
+  template <typename Policy, typename Hash, typename KeyEqual>
+  constexpr std::size_t table<Policy, Hash, KeyEqual>::npos;
+
+  // Walks the full slots of a table
+  template <typename Table, typename Value>
+  class iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::remove_const<Value>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    iterator(Table* t, std::size_t i) noexcept : table_(t), i_(i)
+    {
+      skip();
+    }
+
+    reference operator*() const noexcept { return table_->slot(i_); }
+
+    pointer operator->() const noexcept { return &table_->slot(i_); }
+
+    iterator& operator++() noexcept
+    {
+      ++i_;
+      skip();
+      return *this;
+    }
+
+    iterator operator++(int) noexcept
+    {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const iterator& rhs) const noexcept { return i_ == rhs.i_; }
+
+    bool operator!=(const iterator& rhs) const noexcept { return i_ != rhs.i_; }
+
+    std::size_t index() const noexcept { return i_; }
+
+  private:
+    void skip() noexcept
+    {
+      while (i_ < table_->capacity() && !table_->full(i_)) ++i_;
+    }
+
+    Table* table_;
+    std::size_t i_;
+  };
+
+  template <typename Key>
+  struct set_policy
+  {
+    using key_type = Key;
+    using value_type = Key;
+
+    static const key_type& key(const value_type& v) noexcept { return v; }
+  };
+
+  template <typename Key, typename T>
+  struct map_policy
+  {
+    using key_type = Key;
+    using value_type = std::pair<Key, T>;
+
+    static const key_type& key(const value_type& v) noexcept { return v.first; }
+  };
+
+} // namespace flat
+} // namespace detail
+
+template <typename Signature>
+class delegate_set
+{
+  using table_type = detail::flat::table<
+    detail::flat::set_policy<delegate<Signature>>,
+    std::hash<delegate<Signature>>, std::equal_to<delegate<Signature>>>;
+
+public:
+  using value_type = delegate<Signature>;
+  using const_iterator = detail::flat::iterator<const table_type, const value_type>;
+  using iterator = const_iterator;
+
+  std::size_t size() const noexcept { return table_.size(); }
+
+  bool empty() const noexcept { return !table_.size(); }
+
+  // Number of slots, each taking sizeof(value_type) + 1 bytes
+  std::size_t capacity() const noexcept { return table_.capacity(); }
+
+  const_iterator begin() const noexcept { return {&table_, 0}; }
+
+  const_iterator end() const noexcept { return {&table_, table_.capacity()}; }
+
+  // False if an equal delegate was already there
+  bool insert(value_type d)
+  {
+    return table_.find_or_insert(d, [&d](void* p) {
+      new (p) value_type(std::move(d));
+    }).second;
+  }
+
+  bool contains(const value_type& d) const noexcept
+  {
+    return table_.find(d) != table_type::npos;
+  }
+
+  bool erase(const value_type& d) noexcept
+  {
+    auto const i = table_.find(d);
+    if (i == table_type::npos) return false;
+    table_.erase_at(i);
+    return true;
+  }
+
+  void clear() noexcept { table_.clear(); }
+
+  void reserve(std::size_t n) { table_.reserve(n); }
+
+private:
+  table_type table_;
+};
+
+template <typename Signature, typename T>
+class delegate_map
+{
+  using table_type = detail::flat::table<
+    detail::flat::map_policy<delegate<Signature>, T>,
+    std::hash<delegate<Signature>>, std::equal_to<delegate<Signature>>>;
+
+public:
+  using key_type = delegate<Signature>;
+  using mapped_type = T;
+  using value_type = std::pair<key_type, T>;
+  using iterator = detail::flat::iterator<table_type, value_type>;
+  using const_iterator = detail::flat::iterator<const table_type, const value_type>;
+
+  std::size_t size() const noexcept { return table_.size(); }
+
+  bool empty() const noexcept { return !table_.size(); }
+
+  std::size_t capacity() const noexcept { return table_.capacity(); }
+
+  iterator begin() noexcept { return {&table_, 0}; }
+
+  iterator end() noexcept { return {&table_, table_.capacity()}; }
+
+  const_iterator begin() const noexcept { return {&table_, 0}; }
+
+  const_iterator end() const noexcept { return {&table_, table_.capacity()}; }
+
+  // Inserts T(args...) unless k is there already
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type k, Args&&... args)
+  {
+    auto const r = table_.find_or_insert(k, [&](void* p) {
+      new (p) value_type(std::piecewise_construct,
+        std::forward_as_tuple(std::move(k)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    });
+    return {iterator(&table_, r.first), r.second};
+  }
+
+  T& operator[](key_type k)
+  {
+    return try_emplace(std::move(k)).first->second;
+  }
+
+  // nullptr if k is not there
+  T* find(const key_type& k) noexcept
+  {
+    auto const i = table_.find(k);
+    return i == table_type::npos ? nullptr : &table_.slot(i).second;
+  }
+
+  const T* find(const key_type& k) const noexcept
+  {
+    auto const i = table_.find(k);
+    return i == table_type::npos ? nullptr : &table_.slot(i).second;
+  }
+
+  bool contains(const key_type& k) const noexcept
+  {
+    return table_.find(k) != table_type::npos;
+  }
+
+  bool erase(const key_type& k) noexcept
+  {
+    auto const i = table_.find(k);
+    if (i == table_type::npos) return false;
+    table_.erase_at(i);
+    return true;
+  }
+
+  void clear() noexcept { table_.clear(); }
+
+  void reserve(std::size_t n) { table_.reserve(n); }
+
+private:
+  table_type table_;
+};
+
+#endif // DELEGATE_SET_HPP
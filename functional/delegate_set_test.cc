@@ -0,0 +1,65 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "delegate_set.hpp"
+
+// Delegates owning their functor, inline or on the heap, are found
+// again after insertion, including once the table has grown and moved
+// them.
+
+struct W
+{
+  int on(int x) { return x + n; }
+  int n = 0;
+};
+
+using handler = delegate<int(int)>;
+
+static handler add_value(const int* p)
+{
+  return [p](int x) { return x + *p; };
+}
+
+int main()
+{
+  delegate_set<int(int)> set;
+
+  int k = 1;
+  handler inl([&k](int x) { return x + k; });
+  assert(set.insert(inl));
+  assert(set.contains(inl));
+  assert(!set.insert(handler(inl)));
+
+  handler heap([s = std::string("abc")](int x) { return x + int(s.size()); });
+  assert(set.insert(heap));
+  assert(set.contains(heap));
+
+  // Enough to rehash a few times
+  std::vector<int> values(1000);
+  std::vector<W> ws(1000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    assert(set.insert(add_value(&values[i])));
+    assert(set.insert(handler::from<W, &W::on>(ws[i])));
+  }
+  assert(set.size() == 2002);
+  assert(set.contains(inl) && set.contains(heap));
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    assert(set.contains(add_value(&values[i])));
+  }
+
+  assert(set.erase(inl));
+  assert(!set.contains(inl));
+  assert(set.size() == 2001);
+
+  delegate_map<int(int), int> map;
+  map[inl] = 3;
+  assert(map.try_emplace(inl, 4).second == false);
+  assert(map.find(inl) && *map.find(inl) == 3);
+  map[heap] = 5;
+  assert(map.find(handler(heap)) && *map.find(handler(heap)) == 5);
+  assert(map.erase(inl) && !map.find(inl));
+
+  std::cout << "delegate_set with owning delegates: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <string>
+#include "impl_fast_delegate.hpp"
+
+// Identity of delegates owning their functor: copies compare and hash
+// equal to the original, whether the functor is inline or shared. A
+// static_delegate converts to the delegate the same factory makes.
+
+struct W
+{
+  int on(int x) { return x * n; }
+  int n = 3;
+};
+
+static int twice(int x) { return 2 * x; }
+
+template <typename D>
+static void check_same(D const& a, D const& b)
+{
+  assert(a == b);
+  assert(!(a != b));
+  assert(!(a < b) && !(b < a));
+  assert(std::hash<D>()(a) == std::hash<D>()(b));
+}
+
+int main()
+{
+  using handler = delegate<int(int)>;
+
+  // Inline: trivially copyable and small
+  int k = 1;
+  handler inl([&k](int x) { return x + k; });
+  handler inl_copy(inl);
+  check_same(inl, inl_copy);
+  handler inl_assigned;
+  inl_assigned = inl;
+  check_same(inl, inl_assigned);
+  handler inl_moved(std::move(inl_copy));
+  check_same(inl, inl_moved);
+  assert(inl_moved(1) == 2);
+
+  // Same lambda, other state
+  int j = 2;
+  auto make = [](int* p) { return handler([p](int x) { return x + *p; }); };
+  handler a(make(&k)), b(make(&j));
+  assert(a != b);
+  assert((a < b) != (b < a));
+
+  // Not trivially copyable, so in a shared heap block
+  handler heap([s = std::string("abc")](int x) { return x + int(s.size()); });
+  handler heap_copy(heap);
+  check_same(heap, heap_copy);
+  assert(heap_copy(1) == 4);
+
+  // Deep copies are distinct functors
+  using deep = delegate<int(int), 4 * sizeof(void*), deep_copy_store>;
+  deep d([s = std::string("abc")](int x) { return x + int(s.size()); });
+  deep d_copy(d);
+  assert(d != d_copy);
+  assert(d_copy(1) == 4);
+
+  // static_delegate, by construction and by assignment
+  using static_handler = static_delegate<int(int)>;
+  W w;
+  auto const sf = static_handler::from<&twice>();
+  auto const sm = static_handler::from<W, &W::on>(w);
+  handler from_ctor(sf);
+  handler from_assign;
+  from_assign = sf;
+  check_same(from_ctor, handler::from<&twice>());
+  check_same(from_assign, handler::from<&twice>());
+  from_assign = sm;
+  check_same(from_assign, handler::from<W, &W::on>(w));
+  assert(from_assign(2) == 6);
+  // Replacing an owned functor
+  handler owning(inl);
+  owning = sf;
+  check_same(owning, handler::from<&twice>());
+  assert(owning(4) == 8);
+
+  std::cout << "delegate copies compare equal: ok" << std::endl;
+  return 0;
+}
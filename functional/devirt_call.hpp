@@ -0,0 +1,99 @@
+#pragma once
+#ifndef DEVIRT_CALL_HPP
+# define DEVIRT_CALL_HPP
+
+#include <atomic>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+// Guarded devirtualization of a virtual call through a base pointer:
+//
+//   devirt_call<Derived, Dummy>(base_ptr,
+//     [](auto& o, int v) { return o.fun_function(v); }, v);
+//
+// checks the dynamic type of *base_ptr against each listed class in
+// turn and, on a match, calls f with a reference to that class. The
+// classes must be final, so a call through the reference binds to the
+// override statically and can be inlined. Any other type gets f called
+// with the Base reference, i.e. the ordinary virtual call. A pointer to
+// member would not do: calling through one is a virtual call whatever
+// the class it is applied to.
+//
+// The first object of each listed class seen through B is identified
+// with typeid, and its vtable pointer remembered. From then on a check
+// is one load and compare. Where a class has more than one vtable,
+// e.g. when it is duplicated across shared libraries, the objects using
+// a vtable that was not remembered get the virtual call. That is slower
+// but still correct.
+
+namespace detail
+{
+
+namespace devirt
+{
+
+template <class D, class B>
+inline bool is_exactly(B* const p) noexcept
+{
+  // Per pair, as the vtable pointer of a B subobject depends on both
+  static ::std::atomic<void const*> known{};
+
+  auto const vptr(*reinterpret_cast<void const* const*>(p));
+
+  if (auto const k = known.load(::std::memory_order_relaxed))
+  {
+    return k == vptr;
+  }
+  else if (typeid(*p) == typeid(D))
+  {
+    known.store(vptr, ::std::memory_order_relaxed);
+
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+template <class B, class F, class ...A>
+inline decltype(auto) call(B* const p, F& f, A&& ...args)
+{
+  return f(*p, ::std::forward<A>(args)...);
+}
+
+template <class D, class ...Ds, class B, class F, class ...A>
+inline decltype(auto) call(B* const p, F& f, A&& ...args)
+{
+  static_assert(::std::is_final<D>{},
+    "devirt_call candidates must be final");
+  static_assert(::std::is_base_of<B, D>{},
+    "devirt_call candidates must derive from the pointer type");
+
+  using derived = typename ::std::conditional<::std::is_const<B>{},
+    D const, D>::type;
+
+  if (is_exactly<D>(p))
+  {
+    return f(*static_cast<derived*>(p), ::std::forward<A>(args)...);
+  }
+  else
+  {
+    return call<Ds...>(p, f, ::std::forward<A>(args)...);
+  }
+}
+
+}
+
+}
+
+template <class ...D, class B, class F, class ...A>
+inline decltype(auto) devirt_call(B* const p, F&& f, A&& ...args)
+{
+  static_assert(::std::is_polymorphic<B>{}, "B must be polymorphic");
+
+  return detail::devirt::call<D...>(p, f, ::std::forward<A>(args)...);
+}
+
+#endif // DEVIRT_CALL_HPP
@@ -0,0 +1,246 @@
+#pragma once
+#ifndef EPOLL_REACTOR_HPP
+# define EPOLL_REACTOR_HPP
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "impl_fast_delegate.hpp"
+
+// Linux. A single threaded epoll reactor calling one delegate per fd.
+//
+//   epoll_reactor r;
+//   r.add(fd, EPOLLIN | EPOLLET,
+//     epoll_reactor::handler_type::from<Conn, &Conn::on_ready>(conn));
+//   for (;;) r.run_once();
+//
+// Handlers are kept in an array indexed by fd, allocated in pages of
+// page_size so that they never move, and found from each event with
+// two loads and no lookup. run_once takes up to max_events ready fds
+// from one epoll_wait and calls their handlers in that order.
+//
+// With EPOLLET a handler is only called again once new data arrives,
+// so it has to read until EAGAIN.
+//
+// Handlers may add, modify and remove any fd, their own included.
+// Events still pending in the batch for a removed fd are dropped, even
+// if the fd number was reused by an add in the meantime. A handler that
+// removes or replaces itself is destroyed after it returns.
+//
+// Errors from epoll are reported as std::system_error.
+
+class epoll_reactor
+{
+public:
+  using handler_type = delegate<void (int, ::std::uint32_t)>;
+
+  static constexpr ::std::size_t page_size = 1024;
+
+  explicit epoll_reactor(::std::size_t const max_events = 256) :
+    epfd_(::epoll_create1(EPOLL_CLOEXEC)),
+    events_(max_events)
+  {
+    assert(max_events);
+
+    if (-1 == epfd_)
+    {
+      throw ::std::system_error(errno, ::std::generic_category(),
+        "epoll_create1");
+    }
+  }
+
+  epoll_reactor(epoll_reactor const&) = delete;
+
+  epoll_reactor& operator=(epoll_reactor const&) = delete;
+
+  ~epoll_reactor()
+  {
+    ::close(epfd_);
+  }
+
+  void add(int const fd, ::std::uint32_t const events, handler_type h)
+  {
+    assert(fd >= 0);
+    assert(h);
+
+    auto& s(slot_at(fd));
+
+    control(EPOLL_CTL_ADD, fd, events, s.generation);
+
+    set_handler(fd, s, ::std::move(h));
+  }
+
+  void modify(int const fd, ::std::uint32_t const events)
+  {
+    control(EPOLL_CTL_MOD, fd, events, slot_at(fd).generation);
+  }
+
+  // Does not close fd
+  void remove(int const fd)
+  {
+    auto& s(slot_at(fd));
+
+    assert(s.handler || (fd == current_fd_));
+
+    if (-1 == ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr))
+    {
+      throw ::std::system_error(errno, ::std::generic_category(),
+        "epoll_ctl");
+    }
+
+    // Events for the old registration still in the batch are stale now
+    ++s.generation;
+
+    set_handler(fd, s, nullptr);
+  }
+
+  // Waits up to timeout_ms (-1 for ever) for ready fds and calls their
+  // handlers. Returns the number of events taken, 0 on timeout or when
+  // interrupted by a signal.
+  //
+  // If a handler throws, the exception propagates and the rest of the
+  // batch is dispatched by the next call, without waiting.
+  ::std::size_t run_once(int const timeout_ms = -1)
+  {
+    assert(-1 == current_fd_);
+
+    if (next_ == ready_)
+    {
+      auto const n(::epoll_wait(epfd_, events_.data(),
+        static_cast<int>(events_.size()), timeout_ms));
+
+      if (-1 == n)
+      {
+        if (EINTR == errno)
+        {
+          return 0;
+        }
+
+        throw ::std::system_error(errno, ::std::generic_category(),
+          "epoll_wait");
+      }
+
+      next_ = 0;
+      ready_ = static_cast<::std::size_t>(n);
+    }
+
+    auto const taken(ready_ - next_);
+
+    while (next_ != ready_)
+    {
+      auto const& e(events_[next_++]);
+
+      auto const fd(static_cast<int>(e.data.u64 & 0xffffffff));
+      auto& s(pages_[fd / page_size][fd % page_size]);
+
+      if (s.generation != (e.data.u64 >> 32))
+      {
+        continue;
+      }
+
+      current_fd_ = fd;
+
+      try
+      {
+        s.handler(fd, e.events);
+      }
+      catch (...)
+      {
+        finish_current(s);
+
+        throw;
+      }
+
+      finish_current(s);
+    }
+
+    return taken;
+  }
+
+  // Handler slots for fds up to n - 1, so that add does not allocate
+  void reserve(::std::size_t const n)
+  {
+    while (pages_.size() * page_size < n)
+    {
+      pages_.emplace_back(new slot[page_size]);
+    }
+  }
+
+private:
+  struct slot
+  {
+    handler_type handler;
+    ::std::uint32_t generation{};
+  };
+
+  slot& slot_at(int const fd)
+  {
+    reserve(static_cast<::std::size_t>(fd) + 1);
+
+    return pages_[fd / page_size][fd % page_size];
+  }
+
+  void control(int const op, int const fd, ::std::uint32_t const events,
+    ::std::uint32_t const generation)
+  {
+    epoll_event e{};
+    e.events = events;
+    e.data.u64 = (::std::uint64_t(generation) << 32) |
+      static_cast<::std::uint32_t>(fd);
+
+    if (-1 == ::epoll_ctl(epfd_, op, fd, &e))
+    {
+      throw ::std::system_error(errno, ::std::generic_category(),
+        "epoll_ctl");
+    }
+  }
+
+  // The running handler must outlive its call
+  void set_handler(int const fd, slot& s, handler_type h)
+  {
+    if (fd == current_fd_)
+    {
+      replacement_ = ::std::move(h);
+      replaced_ = true;
+    }
+    else
+    {
+      s.handler = ::std::move(h);
+    }
+  }
+
+  void finish_current(slot& s) noexcept
+  {
+    if (replaced_)
+    {
+      s.handler = ::std::move(replacement_);
+      replacement_ = handler_type();
+      replaced_ = false;
+    }
+
+    current_fd_ = -1;
+  }
+
+  int epfd_;
+
+  ::std::vector<epoll_event> events_;
+  ::std::size_t next_{};
+  ::std::size_t ready_{};
+
+  ::std::vector<::std::unique_ptr<slot[]>> pages_;
+
+  int current_fd_{-1};
+  bool replaced_{};
+  handler_type replacement_;
+};
+
+#endif // EPOLL_REACTOR_HPP
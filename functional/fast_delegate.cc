@@ -1,212 +1,74 @@
-#ifndef SSVU_FASTFUNC
-#define SSVU_FASTFUNC
-
-// https://groups.google.com/a/isocpp.org/forum/#!topic/std-discussion/QgvHF7YMi3o
-
-#include <cstring>
-#include <type_traits>
 #include <cassert>
-#include <cstddef>
-#include <memory>
-#include <new>
-#include <utility>
-
-namespace ssvu
-{
-	namespace Internal
-	{
-		class AnyClass;
-		using AnyPtrThis = AnyClass*;
-		using AnyPtrFunc = void(AnyClass::*)();
-
-		template<typename TReturn = void, typename... TArgs> 
-		using AnyPtrFuncT = TReturn(AnyClass::*)(TArgs...);
-
-		template<typename TReturn = void, typename... TArgs> 
-		using AnyPtrStaticFuncT = TReturn(*)(TArgs...);
-
-		constexpr std::size_t SingleMemFuncPtrSize{sizeof(void(AnyClass::*)())};
-
-		template<class TOut, class TIn> 
-		union HorribleUnion { TOut out; TIn in; };
-
-		template<class TOut, class TIn> 
-		TOut horrible_cast(TIn mIn) noexcept { 
-		  HorribleUnion<TOut, TIn> u; 
-		  static_assert(sizeof(TIn) == sizeof(u) && sizeof(TIn) == sizeof(TOut), "Cannot use horrible_cast<>"); 
-		  u.in = mIn; 
-		  return u.out; 
-		}
-
-		template<class TOut, class TIn> 
-		TOut unsafe_horrible_cast(TIn mIn) noexcept { 
-		  HorribleUnion<TOut, TIn> u; 
-		  u.in = mIn; return u.out; 
-		}
-
-		template<std::size_t TN> struct SimplifyMemFunc
-		{
-			template<class TThis, class TFunc> static AnyPtrThis convert(const TThis*, TFunc, AnyPtrFunc&) noexcept
-			{
-				static_assert(TN - 100, "Unsupported member function pointer on this compiler");
-				return 0;
-			}
-		};
-		template<> struct SimplifyMemFunc<SingleMemFuncPtrSize>
-		{
-			template<class TThis, class TFunc> static AnyPtrThis convert(const TThis* mThis, TFunc mFunc, AnyPtrFunc& mFuncOut) noexcept
-			{
-				mFuncOut = reinterpret_cast<AnyPtrFunc>(mFunc);
-				return reinterpret_cast<AnyPtrThis>(const_cast<TThis*>(mThis));
-			}
-		};
-
-		template<typename TReturn, typename... TArgs> 
-		struct Closure
-		{
-		private:
-		  using PtrFuncT = AnyPtrFuncT<TReturn, TArgs...>;
-		  using PtrStaticFuncT = AnyPtrStaticFuncT<TReturn, TArgs...>;
-		  AnyPtrThis ptrThis{nullptr};
-		  AnyPtrFunc ptrFunction{nullptr};
-
-		public:
-		  template<class TThis, class TFunc> 
-		  void bind(TThis* mThis, TFunc mFunc) noexcept { 
-		    ptrThis = SimplifyMemFunc<sizeof(mFunc)>::convert(mThis, mFunc, ptrFunction); 
-		  }
-
-		  template<class TThis, class TInvoker> 
-		  void bind(TThis* mThis, TInvoker mInvoker, PtrStaticFuncT mFunc) noexcept
-		  {
-		    if(mFunc == nullptr) ptrFunction = nullptr; 
-		    else bind(mThis, mInvoker);
-
-		    ptrThis = horrible_cast<AnyPtrThis>(mFunc);
-		  }
-
-		  bool operator==(std::nullptr_t) const noexcept		
-		  { return ptrThis == nullptr && ptrFunction == nullptr; }
-
-		  bool operator==(const Closure& mRhs) const noexcept	
-		  { return ptrThis == mRhs.ptrThis && ptrFunction == mRhs.ptrFunction; }
-
-		  bool operator==(PtrStaticFuncT mPtr) const noexcept	
-		  { return mPtr == nullptr ? *this == nullptr : mPtr == reinterpret_cast<PtrStaticFuncT>(getStaticFunc()); }
-
-		  bool operator!=(std::nullptr_t) const noexcept		{ return !operator==(nullptr); }
-		  bool operator!=(const Closure& mRhs) const noexcept	{ return !operator==(mRhs); }
-		  bool operator!=(PtrStaticFuncT mPtr) const noexcept	{ return !operator==(mPtr); }
-
-		  bool operator<(const Closure& mRhs) const			
-		  { return ptrThis != mRhs.ptrThis ? ptrThis < mRhs.ptrThis : std::memcmp(&ptrFunction, &mRhs.ptrFunction, sizeof(ptrFunction)) < 0; }
-
-		  bool operator>(const Closure& mRhs) const			{ return !operator<(mRhs); }
-
-		  std::size_t getHash() const noexcept					
-		  { return reinterpret_cast<std::size_t>(ptrThis) ^ Internal::unsafe_horrible_cast<std::size_t>(ptrFunction); }
-
-		  AnyPtrThis getPtrThis() const noexcept		{ return ptrThis; }
-		  PtrFuncT getPtrFunction() const noexcept	{ return reinterpret_cast<PtrFuncT>(ptrFunction); }
-		  PtrStaticFuncT getStaticFunc() const noexcept	{ return horrible_cast<PtrStaticFuncT>(this); }
-		};
+#include <iostream>
+#include "fast_func.hpp"
 
-		template<typename TReturn, typename... TArgs> 
-		class FastFuncImpl
-		{
-		  private:
-		    using PtrStaticFuncT = AnyPtrStaticFuncT<TReturn, TArgs...>;
-		    Closure<TReturn, TArgs...> closure;
-		    TReturn invokeStaticFunc(TArgs... mArgs) const { 
-		      return (*(closure.getStaticFunc()))(std::forward<TArgs>(mArgs)...); 
-		    }
+// Binding FastFunc to member functions of classes with multiple and
+// virtual inheritance. Each call checks it ran on the right subobject.
 
-		  protected:
-		    template<class TThis, class TFunc> 
-		    void bind(TThis* mThis, TFunc mFunc) noexcept { 
-		      closure.bind(mThis, mFunc); 
-		    }
-
-		    template<class TFunc> 
-		    void bind(TFunc mFunc) noexcept { 
-		      closure.bind(this, &FastFuncImpl::invokeStaticFunc, mFunc); 
-		    }
-
-		  public:
-		    FastFuncImpl() noexcept = default;
-		    FastFuncImpl(std::nullptr_t) noexcept { }
-		    FastFuncImpl(PtrStaticFuncT mFunc) noexcept { bind(mFunc); }
-
-		    template<typename X, typename Y> 
-		    FastFuncImpl(X* mThis, Y mFunc) noexcept { bind(mThis, mFunc); }
-
-
-		    FastFuncImpl& operator=(PtrStaticFuncT mFunc) noexcept	
-		    { bind(mFunc); }
-
-		    TReturn operator()(TArgs... mArgs) const	
-		    { return (closure.getPtrThis()->*(closure.getPtrFunction()))(std::forward<TArgs>(mArgs)...); }
-
-		  bool operator==(std::nullptr_t) const noexcept		    { return closure == nullptr; }
-		  bool operator==(const FastFuncImpl& mImpl) const noexcept  { return closure == mImpl.closure; }
-		  bool operator==(PtrStaticFuncT mFuncPtr) const noexcept    { return closure == mFuncPtr; }
-		  bool operator!=(std::nullptr_t) const noexcept		    { return !operator==(nullptr); }
-		  bool operator!=(const FastFuncImpl& mImpl) const noexcept  { return !operator==(mImpl); }
-		  bool operator!=(PtrStaticFuncT mFuncPtr) const noexcept    { return !operator==(mFuncPtr); }
-		  bool operator<(const FastFuncImpl& mImpl) const	    { return closure < mImpl.closure; }
-		  bool operator>(const FastFuncImpl& mImpl) const	    { return !operator<(mImpl); }
-		};
-	}
-
-	template<typename T> struct MemFuncToFunc;
-	template<typename TReturn, typename TThis, typename... TArgs> 
-	struct MemFuncToFunc<TReturn(TThis::*)(TArgs...) const> { using Type = TReturn(*)(TArgs...); };
-
-	#define ENABLE_IF_CONV_TO_FUN_PTR(x) \
-	  typename std::enable_if<std::is_constructible<typename MemFuncToFunc<decltype(&std::decay<x>::type::operator())>::Type, x>::value>::type* = nullptr
-
-	#define ENABLE_IF_NOT_CONV_TO_FUN_PTR(x) \
-	typename std::enable_if<!std::is_constructible<typename MemFuncToFunc<decltype(&std::decay<x>::type::operator())>::Type, x>::value>::type* = nullptr
-
-	#define ENABLE_IF_SAME_TYPE(x, y) \
-	typename = typename std::enable_if<!std::is_same<x, typename std::decay<y>::type>{}>::type
-
-	template<typename T> class FastFunc;
-
-	template<typename TReturn, typename... TArgs> 
-	class FastFunc<TReturn(TArgs...)> : public Internal::FastFuncImpl<TReturn, TArgs...>
-	{
-	private:
-	  using BaseType = Internal::FastFuncImpl<TReturn, TArgs...>;
-	  std::shared_ptr<void> storage;
-	  template<typename T> 
-	  static void funcDeleter(void* mPtr) { static_cast<T*>(mPtr)->~T(); operator delete(mPtr); }
-
-	public:
-	  using BaseType::BaseType;
-
-	  FastFunc() noexcept = default;
-
-	  template<typename TFunc, ENABLE_IF_SAME_TYPE(FastFunc, TFunc)> 
-	  FastFunc(TFunc&& mFunc, ENABLE_IF_CONV_TO_FUN_PTR(TFunc))
-	  {
-	    using FuncType = typename std::decay<TFunc>::type;
-	    this->bind(&mFunc, &FuncType::operator());
-	  }
+// The A/B/C/D diamond of inheritance_my.cc, with data and functions.
+// D holds two A subobjects.
+struct A { int a = 1; int getA() const { return a; } };
+struct B : A { int b = 2; int getB() const { return b + a; } };
+struct C : A
+{
+  C() { a = 10; }
+  virtual ~C() = default;
+  int getC() const { return c + a; }
+  virtual int name() const { return 'C'; }
+  int c = 20;
+};
+struct D : B, C
+{
+  int name() const override { return 'D' + d; }
+  int d = 0;
+};
 
-	  template<typename TFunc, ENABLE_IF_SAME_TYPE(FastFunc, TFunc)> 
-	  FastFunc(TFunc&& mFunc, ENABLE_IF_NOT_CONV_TO_FUN_PTR(TFunc))
-				: storage(operator new(sizeof(TFunc)), funcDeleter<typename std::decay<TFunc>::type>)
-	  {
-	    using FuncType = typename std::decay<TFunc>::type;
-	    new (storage.get()) FuncType(std::forward<TFunc>(mFunc));
-	    this->bind(storage.get(), &FuncType::operator());
-	  }
-	};
+// The same diamond with A as a virtual base: one shared A
+struct VA
+{
+  virtual ~VA() = default;
+  virtual int name() const { return 'A'; }
+  int a = 100;
+};
+struct VB : virtual VA { int getB() { return a + b; } int b = 200; };
+struct VC : virtual VA { int getC() { return a + c; } int c = 300; };
+struct VD : VB, VC
+{
+  int name() const override { return 'D'; }
+  int getD() { return a + b + c + d; }
+  int d = 400;
+};
 
-	#undef ENABLE_IF_CONV_TO_FUN_PTR
-	#undef ENABLE_IF_NOT_CONV_TO_FUN_PTR
-	#undef ENABLE_IF_SAME_TYPE
+int main()
+{
+  using Getter = ssvu::FastFunc<int()>;
+
+  D d;
+  assert(Getter(&d, &B::getB)() == 3);
+  assert(Getter(&d, &C::getC)() == 30);
+  // The two A subobjects, reached through B and C
+  assert(Getter(static_cast<B*>(&d), &A::getA)() == 1);
+  assert(Getter(static_cast<C*>(&d), &A::getA)() == 10);
+  // A member pointer of D to a function of C, carrying an adjustment
+  int (D::*getC)() const = &C::getC;
+  assert(Getter(&d, getC)() == 30);
+  // Virtual through the second base, overridden in D
+  Getter name(&d, &C::name);
+  assert(name() == 'D');
+  d.d = 1;
+  assert(name() == 'D' + 1);
+
+  VD vd;
+  assert(Getter(&vd, &VB::getB)() == 300);
+  assert(Getter(&vd, &VC::getC)() == 400);
+  assert(Getter(&vd, &VD::getD)() == 1000);
+  // The virtual base is found through the vtable when binding
+  assert(Getter(&vd, &VA::name)() == 'D');
+  int (VD::*getVC)() = &VC::getC;
+  assert(Getter(&vd, getVC)() == 400);
+  VC* vc = &vd;
+  assert(Getter(vc, &VA::name)() == 'D');
+
+  std::cout << "FastFunc multiple and virtual inheritance: ok" << std::endl;
+  return 0;
 }
-
-#endif
@@ -0,0 +1,315 @@
+#pragma once
+#ifndef SSVU_FASTFUNC
+#define SSVU_FASTFUNC
+
+// https://groups.google.com/a/isocpp.org/forum/#!topic/std-discussion/QgvHF7YMi3o
+//
+// A FastFunc bound to an object and a member function is one object
+// pointer and one member function pointer, called as (this->*fn)().
+// Binding converts the object to the class the member function belongs
+// to, which takes care of base subobjects and virtual bases, and on
+// the Itanium C++ ABI also folds the this-adjustment stored in the
+// member pointer into the object pointer.
+
+#include <cstring>
+#include <type_traits>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace ssvu
+{
+	namespace Internal
+	{
+		class AnyClass;
+		using AnyPtrThis = AnyClass*;
+		using AnyPtrFunc = void(AnyClass::*)();
+
+		template<typename TReturn = void, typename... TArgs> 
+		using AnyPtrFuncT = TReturn(AnyClass::*)(TArgs...);
+
+		template<typename TReturn = void, typename... TArgs> 
+		using AnyPtrStaticFuncT = TReturn(*)(TArgs...);
+
+		constexpr std::size_t SingleMemFuncPtrSize{sizeof(void(AnyClass::*)())};
+
+		template<class TOut, class TIn> 
+		union HorribleUnion { TOut out; TIn in; };
+
+		template<class TOut, class TIn> 
+		TOut horrible_cast(TIn mIn) noexcept { 
+		  HorribleUnion<TOut, TIn> u; 
+		  static_assert(sizeof(TIn) == sizeof(u) && sizeof(TIn) == sizeof(TOut), "Cannot use horrible_cast<>"); 
+		  u.in = mIn; 
+		  return u.out; 
+		}
+
+		template<class TOut, class TIn> 
+		TOut unsafe_horrible_cast(TIn mIn) noexcept { 
+		  HorribleUnion<TOut, TIn> u; 
+		  u.in = mIn; return u.out; 
+		}
+
+		template<typename T> struct MemFuncClass;
+		template<typename TReturn, class TClass, typename... TArgs> 
+		struct MemFuncClass<TReturn(TClass::*)(TArgs...)> { using Type = TClass; };
+		template<typename TReturn, class TClass, typename... TArgs> 
+		struct MemFuncClass<TReturn(TClass::*)(TArgs...) const> { using Type = TClass; };
+
+		// Converts to the class of the member function: a no-op for the
+		// class itself, an offset for a base, a vtable lookup for a
+		// virtual base. Downcasts do not compile.
+		template<class TFunc, class TThis> 
+		typename MemFuncClass<TFunc>::Type* toMemFuncClass(TThis* mThis) noexcept { return mThis; }
+
+#if !defined(_MSC_VER)
+		// Itanium C++ ABI: { function pointer or 1 + vtable offset, this-adjustment }.
+		// ARM keeps the virtual flag in the low bit of the adjustment, which is doubled.
+		struct ItaniumMemFuncPtr { std::uintptr_t ptr; std::ptrdiff_t adj; };
+
+		static_assert(sizeof(ItaniumMemFuncPtr) == SingleMemFuncPtrSize, "Unexpected member function pointer size");
+
+	#if defined(__arm__) || defined(__aarch64__)
+		constexpr int ItaniumAdjShift{1};
+	#else
+		constexpr int ItaniumAdjShift{0};
+	#endif
+#endif
+
+		template<std::size_t TN> struct SimplifyMemFunc
+		{
+			template<class TThis, class TFunc> static AnyPtrThis convert(const TThis*, TFunc, AnyPtrFunc&) noexcept
+			{
+				static_assert(TN - 100, "Unsupported member function pointer on this compiler");
+				return 0;
+			}
+		};
+		template<> struct SimplifyMemFunc<SingleMemFuncPtrSize>
+		{
+			template<class TThis, class TFunc> static AnyPtrThis convert(const TThis* mThis, TFunc mFunc, AnyPtrFunc& mFuncOut) noexcept
+			{
+				auto self(reinterpret_cast<char*>(toMemFuncClass<TFunc>(const_cast<TThis*>(mThis))));
+#if !defined(_MSC_VER)
+				ItaniumMemFuncPtr repr;
+				std::memcpy(&repr, &mFunc, sizeof(repr));
+				self += repr.adj >> ItaniumAdjShift;
+				repr.adj &= (1 << ItaniumAdjShift) - 1;
+				std::memcpy(&mFuncOut, &repr, sizeof(repr));
+#else
+				mFuncOut = reinterpret_cast<AnyPtrFunc>(mFunc);
+#endif
+				return reinterpret_cast<AnyPtrThis>(self);
+			}
+		};
+
+		template<typename TReturn, typename... TArgs> 
+		struct Closure
+		{
+		private:
+		  using PtrFuncT = AnyPtrFuncT<TReturn, TArgs...>;
+		  using PtrStaticFuncT = AnyPtrStaticFuncT<TReturn, TArgs...>;
+		  AnyPtrThis ptrThis{nullptr};
+		  AnyPtrFunc ptrFunction{nullptr};
+
+		public:
+		  template<class TThis, class TFunc> 
+		  void bind(TThis* mThis, TFunc mFunc) noexcept { 
+		    ptrThis = SimplifyMemFunc<sizeof(mFunc)>::convert(mThis, mFunc, ptrFunction); 
+		  }
+
+		  template<class TThis, class TInvoker> 
+		  void bind(TThis* mThis, TInvoker mInvoker, PtrStaticFuncT mFunc) noexcept
+		  {
+		    if(mFunc == nullptr) ptrFunction = nullptr; 
+		    else bind(mThis, mInvoker);
+
+		    ptrThis = horrible_cast<AnyPtrThis>(mFunc);
+		  }
+
+		  bool operator==(std::nullptr_t) const noexcept		
+		  { return ptrThis == nullptr && ptrFunction == nullptr; }
+
+		  bool operator==(const Closure& mRhs) const noexcept	
+		  { return ptrThis == mRhs.ptrThis && ptrFunction == mRhs.ptrFunction; }
+
+		  bool operator==(PtrStaticFuncT mPtr) const noexcept	
+		  { return mPtr == nullptr ? *this == nullptr : mPtr == reinterpret_cast<PtrStaticFuncT>(getStaticFunc()); }
+
+		  bool operator!=(std::nullptr_t) const noexcept		{ return !operator==(nullptr); }
+		  bool operator!=(const Closure& mRhs) const noexcept	{ return !operator==(mRhs); }
+		  bool operator!=(PtrStaticFuncT mPtr) const noexcept	{ return !operator==(mPtr); }
+
+		  bool operator<(const Closure& mRhs) const			
+		  { return ptrThis != mRhs.ptrThis ? ptrThis < mRhs.ptrThis : std::memcmp(&ptrFunction, &mRhs.ptrFunction, sizeof(ptrFunction)) < 0; }
+
+		  bool operator>(const Closure& mRhs) const			{ return !operator<(mRhs); }
+
+		  std::size_t getHash() const noexcept					
+		  { return reinterpret_cast<std::size_t>(ptrThis) ^ Internal::unsafe_horrible_cast<std::size_t>(ptrFunction); }
+
+		  AnyPtrThis getPtrThis() const noexcept		{ return ptrThis; }
+		  void setPtrThis(AnyPtrThis mPtrThis) noexcept	{ ptrThis = mPtrThis; }
+		  PtrFuncT getPtrFunction() const noexcept	{ return reinterpret_cast<PtrFuncT>(ptrFunction); }
+		  PtrStaticFuncT getStaticFunc() const noexcept	{ return horrible_cast<PtrStaticFuncT>(this); }
+		};
+
+		template<typename TReturn, typename... TArgs> 
+		class FastFuncImpl
+		{
+		  private:
+		    using PtrStaticFuncT = AnyPtrStaticFuncT<TReturn, TArgs...>;
+		    Closure<TReturn, TArgs...> closure;
+		    TReturn invokeStaticFunc(TArgs... mArgs) const { 
+		      return (*(closure.getStaticFunc()))(std::forward<TArgs>(mArgs)...); 
+		    }
+
+		  protected:
+		    template<class TThis, class TFunc> 
+		    void bind(TThis* mThis, TFunc mFunc) noexcept { 
+		      closure.bind(mThis, mFunc); 
+		    }
+
+		    template<class TFunc> 
+		    void bind(TFunc mFunc) noexcept { 
+		      closure.bind(this, &FastFuncImpl::invokeStaticFunc, mFunc); 
+		    }
+
+		    // For functors stored inside the derived object: a copy has to
+		    // call its own functor, not the one it was copied from
+		    const void* getBoundObject() const noexcept { 
+		      return closure.getPtrThis(); 
+		    }
+
+		    void rebind(void* mPtr) noexcept { 
+		      closure.setPtrThis(reinterpret_cast<AnyPtrThis>(mPtr)); 
+		    }
+
+		  public:
+		    FastFuncImpl() noexcept = default;
+		    FastFuncImpl(std::nullptr_t) noexcept { }
+		    FastFuncImpl(PtrStaticFuncT mFunc) noexcept { bind(mFunc); }
+
+		    template<typename X, typename Y> 
+		    FastFuncImpl(X* mThis, Y mFunc) noexcept { bind(mThis, mFunc); }
+
+
+		    FastFuncImpl& operator=(PtrStaticFuncT mFunc) noexcept	
+		    { bind(mFunc); return *this; }
+
+		    TReturn operator()(TArgs... mArgs) const	
+		    { return (closure.getPtrThis()->*(closure.getPtrFunction()))(std::forward<TArgs>(mArgs)...); }
+
+		  bool operator==(std::nullptr_t) const noexcept		    { return closure == nullptr; }
+		  bool operator==(const FastFuncImpl& mImpl) const noexcept  { return closure == mImpl.closure; }
+		  bool operator==(PtrStaticFuncT mFuncPtr) const noexcept    { return closure == mFuncPtr; }
+		  bool operator!=(std::nullptr_t) const noexcept		    { return !operator==(nullptr); }
+		  bool operator!=(const FastFuncImpl& mImpl) const noexcept  { return !operator==(mImpl); }
+		  bool operator!=(PtrStaticFuncT mFuncPtr) const noexcept    { return !operator==(mFuncPtr); }
+		  bool operator<(const FastFuncImpl& mImpl) const	    { return closure < mImpl.closure; }
+		  bool operator>(const FastFuncImpl& mImpl) const	    { return !operator<(mImpl); }
+		};
+	}
+
+	#define ENABLE_IF_SAME_TYPE(x, y) \
+	typename = typename std::enable_if<!std::is_same<x, typename std::decay<y>::type>{}>::type
+
+	template<typename T> class FastFunc;
+
+	// Functors are stored in one of three ways:
+	// - captureless lambdas (anything convertible to the function pointer
+	//   type) are converted and called through invokeStaticFunc
+	// - small trivially copyable functors live in inlineStorage; copies
+	//   memcpy it and rebind to their own copy
+	// - everything else is allocated and shared between copies
+	template<typename TReturn, typename... TArgs> 
+	class FastFunc<TReturn(TArgs...)> : public Internal::FastFuncImpl<TReturn, TArgs...>
+	{
+	private:
+	  using BaseType = Internal::FastFuncImpl<TReturn, TArgs...>;
+	  using PtrStaticFuncT = Internal::AnyPtrStaticFuncT<TReturn, TArgs...>;
+	  static constexpr std::size_t inlineSize{2 * sizeof(void*)};
+
+	  template<typename T> 
+	  using IsStateless = std::is_convertible<T, PtrStaticFuncT>;
+
+	  template<typename T, typename TDecayed = typename std::decay<T>::type> 
+	  using IsInline = std::integral_constant<bool, !IsStateless<T>::value 
+	    && sizeof(TDecayed) <= inlineSize && alignof(TDecayed) <= alignof(void*)
+	    && std::is_trivially_copyable<TDecayed>::value 
+	    && std::is_trivially_destructible<TDecayed>::value>;
+
+	  std::shared_ptr<void> storage;
+	  alignas(void*) unsigned char inlineStorage[inlineSize]{};
+
+	  template<typename T> 
+	  static void funcDeleter(void* mPtr) { static_cast<T*>(mPtr)->~T(); operator delete(mPtr); }
+
+	  void copyInline(const FastFunc& mOther) noexcept
+	  {
+	    // The bound object may be a base subobject of the stored functor
+	    auto bound = static_cast<const unsigned char*>(mOther.getBoundObject());
+	    std::uintptr_t offset = reinterpret_cast<std::uintptr_t>(bound) 
+	      - reinterpret_cast<std::uintptr_t>(mOther.inlineStorage);
+	    if(offset >= inlineSize) return;
+	    std::memcpy(inlineStorage, mOther.inlineStorage, inlineSize);
+	    this->rebind(inlineStorage + offset);
+	  }
+
+	public:
+	  using BaseType::BaseType;
+
+	  FastFunc() noexcept = default;
+
+	  FastFunc(const FastFunc& mOther) noexcept 
+	    : BaseType(mOther), storage(mOther.storage) { copyInline(mOther); }
+
+	  FastFunc(FastFunc&& mOther) noexcept 
+	    : BaseType(mOther), storage(std::move(mOther.storage)) { copyInline(mOther); }
+
+	  FastFunc& operator=(const FastFunc& mOther) noexcept
+	  {
+	    if(this == &mOther) return *this;
+	    BaseType::operator=(mOther);
+	    storage = mOther.storage;
+	    copyInline(mOther);
+	    return *this;
+	  }
+
+	  FastFunc& operator=(FastFunc&& mOther) noexcept
+	  {
+	    if(this == &mOther) return *this;
+	    BaseType::operator=(mOther);
+	    storage = std::move(mOther.storage);
+	    copyInline(mOther);
+	    return *this;
+	  }
+
+	  template<typename TFunc, ENABLE_IF_SAME_TYPE(FastFunc, TFunc)> 
+	  FastFunc(TFunc&& mFunc, typename std::enable_if<IsStateless<TFunc>::value>::type* = nullptr) noexcept
+	    : BaseType(static_cast<PtrStaticFuncT>(mFunc)) { }
+
+	  template<typename TFunc, ENABLE_IF_SAME_TYPE(FastFunc, TFunc)> 
+	  FastFunc(TFunc&& mFunc, typename std::enable_if<IsInline<TFunc>::value>::type* = nullptr) noexcept
+	  {
+	    using FuncType = typename std::decay<TFunc>::type;
+	    FuncType* func = new (inlineStorage) FuncType(std::forward<TFunc>(mFunc));
+	    this->bind(func, &FuncType::operator());
+	  }
+
+	  template<typename TFunc, ENABLE_IF_SAME_TYPE(FastFunc, TFunc)> 
+	  FastFunc(TFunc&& mFunc, typename std::enable_if<!IsStateless<TFunc>::value && !IsInline<TFunc>::value>::type* = nullptr)
+				: storage(operator new(sizeof(TFunc)), funcDeleter<typename std::decay<TFunc>::type>)
+	  {
+	    using FuncType = typename std::decay<TFunc>::type;
+	    FuncType* func = new (storage.get()) FuncType(std::forward<TFunc>(mFunc));
+	    this->bind(func, &FuncType::operator());
+	  }
+	};
+
+	#undef ENABLE_IF_SAME_TYPE
+}
+
+#endif
@@ -0,0 +1,244 @@
+#pragma once
+#ifndef FUNC_POOL_HPP
+# define FUNC_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdlib.h> // aligned_alloc
+#include <vector>
+
+/*
+ * Pooled allocation for Function targets that do not fit inline.
+ *
+ *   Function<void()> f(std::allocator_arg, pool_allocator<char>(), cb);
+ *
+ * Each thread owns a pool with one free list per size class. Blocks
+ * are carved out of 64 KB slabs aligned to their size, so the slab
+ * header (and with it the owning pool) is found by masking the block
+ * address. A block freed by another thread is pushed onto a lock-free
+ * list of the owner, which takes the whole list back on its next
+ * miss. Memory is never returned to the system: the pool of an
+ * exiting thread is handed over to the next thread that starts
+ * allocating.
+ */
+
+namespace detail {
+namespace func_pool {
+
+  constexpr std::size_t slab_size = 64 * 1024;
+  constexpr std::size_t min_block = 16;
+  constexpr std::size_t num_classes = 7; // 16 .. 1024 bytes
+  constexpr std::size_t max_block = min_block << (num_classes - 1);
+  // Blocks are multiples of 16 from a 16 aligned start
+  constexpr std::size_t block_align = 16;
+
+  inline std::size_t size_class(std::size_t bytes) noexcept
+  {
+    std::size_t cls = 0;
+    for (std::size_t sz = min_block; sz < bytes; sz <<= 1) ++cls;
+    return cls;
+  }
+
+  constexpr std::size_t class_size(std::size_t cls) noexcept
+  {
+    return min_block << cls;
+  }
+
+  struct free_block { free_block* next; };
+
+  class thread_pool;
+
+  struct alignas(64) slab_header
+  {
+    thread_pool* owner;
+  };
+
+  inline slab_header* slab_of(void* p) noexcept
+  {
+    return reinterpret_cast<slab_header*>(
+        reinterpret_cast<std::uintptr_t>(p) & ~(slab_size - 1));
+  }
+
+  class thread_pool
+  {
+  public:
+    thread_pool()
+    {
+      for (auto& r : remote_) r.store(nullptr, std::memory_order_relaxed);
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    void* allocate(std::size_t cls)
+    {
+      free_block* b = local_[cls];
+      if (!b) {
+        // Take back everything other threads returned so far
+        b = remote_[cls].exchange(nullptr, std::memory_order_acquire);
+      }
+      if (b) {
+        local_[cls] = b->next;
+        return b;
+      }
+      return carve(class_size(cls));
+    }
+
+    void release(void* p, std::size_t cls) noexcept
+    {
+      auto b = static_cast<free_block*>(p);
+      b->next = local_[cls];
+      local_[cls] = b;
+    }
+
+    // Called by threads other than the owner
+    void release_remote(void* p, std::size_t cls) noexcept
+    {
+      auto b = static_cast<free_block*>(p);
+      b->next = remote_[cls].load(std::memory_order_relaxed);
+      while (!remote_[cls].compare_exchange_weak(b->next, b,
+               std::memory_order_release, std::memory_order_relaxed))
+        ;
+    }
+
+  private:
+    void* carve(std::size_t size)
+    {
+      if (bump_ + size > bump_end_) new_slab();
+      void* p = bump_;
+      bump_ += size;
+      return p;
+    }
+
+    void new_slab()
+    {
+      auto s = static_cast<char*>(::aligned_alloc(slab_size, slab_size));
+      if (!s) throw std::bad_alloc();
+      new (s) slab_header{this};
+      bump_ = s + sizeof(slab_header);
+      bump_end_ = s + slab_size;
+    }
+
+  private:
+    free_block* local_[num_classes] = {};
+    char* bump_ = nullptr;
+    char* bump_end_ = nullptr;
+    // Keeps the remote lists, written by other threads, off the
+    // cache line(s) of the owner only fields
+    char pad_[64];
+    std::atomic<free_block*> remote_[num_classes];
+  };
+
+  // Pools of exited threads, waiting to be adopted
+  class registry
+  {
+  public:
+    static registry& instance()
+    {
+      // Never destroyed: blocks may be freed during static destruction
+      static registry* r = new registry;
+      return *r;
+    }
+
+    thread_pool* adopt()
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      if (abandoned_.empty()) return new thread_pool;
+      auto p = abandoned_.back();
+      abandoned_.pop_back();
+      return p;
+    }
+
+    void abandon(thread_pool* p)
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      abandoned_.push_back(p);
+    }
+
+  private:
+    std::mutex mtx_;
+    std::vector<thread_pool*> abandoned_;
+  };
+
+  struct pool_handle
+  {
+    pool_handle(): pool(registry::instance().adopt()) {}
+    ~pool_handle() { registry::instance().abandon(pool); }
+
+    thread_pool* pool;
+  };
+
+  inline thread_pool& local_pool()
+  {
+    static thread_local pool_handle h;
+    return *h.pool;
+  }
+
+  inline void* allocate(std::size_t bytes)
+  {
+    return local_pool().allocate(size_class(bytes));
+  }
+
+  inline void deallocate(void* p, std::size_t bytes) noexcept
+  {
+    thread_pool& owner = *slab_of(p)->owner;
+    thread_pool& me = local_pool();
+    if (&owner == &me) me.release(p, size_class(bytes));
+    else owner.release_remote(p, size_class(bytes));
+  }
+
+} // namespace func_pool
+} // namespace detail
+
+// Stateless allocator drawing from the calling thread's pool.
+// Requests above the largest size class, or needing more than 16
+// byte alignment, go to operator new.
+template <typename T>
+class pool_allocator
+{
+public:
+  using value_type = T;
+
+  pool_allocator() noexcept = default;
+
+  template <typename U>
+  pool_allocator(const pool_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n)
+  {
+    if (pooled(n)) {
+      return static_cast<T*>(detail::func_pool::allocate(n * sizeof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept
+  {
+    if (pooled(n)) detail::func_pool::deallocate(p, n * sizeof(T));
+    else ::operator delete(p);
+  }
+
+private:
+  static bool pooled(std::size_t n) noexcept
+  {
+    return n * sizeof(T) <= detail::func_pool::max_block &&
+      alignof(T) <= detail::func_pool::block_align;
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) noexcept
+{
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) noexcept
+{
+  return false;
+}
+
+#endif // FUNC_POOL_HPP
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef FUNCTION_REF_HPP
+# define FUNCTION_REF_HPP
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Non-owning reference to a callable, for callbacks that are only used
+// for the duration of a call (visitors, comparators...).
+// It is two words, trivially copyable and never allocates. The bound
+// callable must outlive the function_ref.
+
+template <typename T> class function_ref;
+
+template <class R, class ...A>
+class function_ref<R (A...)>
+{
+  // Either the bound object or a plain function pointer
+  union target
+  {
+    void* object_ptr;
+    R (*function_ptr)(A...);
+  };
+
+  using stub_ptr_type = R (*)(target, A&&...);
+
+  function_ref(void* const o, stub_ptr_type const m) noexcept :
+    stub_ptr_(m)
+  {
+    target_.object_ptr = o;
+  }
+
+public:
+  function_ref() = delete;
+
+  function_ref(function_ref const&) = default;
+
+  function_ref& operator=(function_ref const&) = default;
+
+  function_ref(R (* const function_ptr)(A...)) noexcept :
+    stub_ptr_(function_ptr_stub)
+  {
+    target_.function_ptr = function_ptr;
+  }
+
+  template <
+    typename T,
+    typename = typename ::std::enable_if<
+      !::std::is_same<function_ref, typename ::std::decay<T>::type>{} &&
+      !::std::is_pointer<typename ::std::decay<T>::type>{}
+    >::type
+  >
+  function_ref(T&& f) noexcept :
+    function_ref(const_cast<void*>(static_cast<void const*>(
+        ::std::addressof(f))),
+      functor_stub<typename ::std::remove_reference<T>::type>)
+  {
+  }
+
+  template <R (* const function_ptr)(A...)>
+  static function_ref from() noexcept
+  {
+    return { nullptr, static_function_stub<function_ptr> };
+  }
+
+  // The member pointer is a template argument so that the object
+  // pointer is all there is to store.
+  template <class C, R (C::* const method_ptr)(A...)>
+  static function_ref from(C& object) noexcept
+  {
+    return { &object, method_stub<C, method_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...) const>
+  static function_ref from(C const& object) noexcept
+  {
+    return { const_cast<C*>(&object), const_method_stub<C, method_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...)>
+  static function_ref from(C* const object_ptr) noexcept
+  {
+    return { object_ptr, method_stub<C, method_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...) const>
+  static function_ref from(C const* const object_ptr) noexcept
+  {
+    return { const_cast<C*>(object_ptr), const_method_stub<C, method_ptr> };
+  }
+
+  R operator()(A... args) const
+  {
+    return stub_ptr_(target_, ::std::forward<A>(args)...);
+  }
+
+private:
+  target target_;
+  stub_ptr_type stub_ptr_;
+
+  static R function_ptr_stub(target const t, A&&... args)
+  {
+    return t.function_ptr(::std::forward<A>(args)...);
+  }
+
+  template <R (*function_ptr)(A...)>
+  static R static_function_stub(target, A&&... args)
+  {
+    return function_ptr(::std::forward<A>(args)...);
+  }
+
+  template <class C, R (C::*method_ptr)(A...)>
+  static R method_stub(target const t, A&&... args)
+  {
+    return (static_cast<C*>(t.object_ptr)->*method_ptr)(
+      ::std::forward<A>(args)...);
+  }
+
+  template <class C, R (C::*method_ptr)(A...) const>
+  static R const_method_stub(target const t, A&&... args)
+  {
+    return (static_cast<C const*>(t.object_ptr)->*method_ptr)(
+      ::std::forward<A>(args)...);
+  }
+
+  template <typename T>
+  static R functor_stub(target const t, A&&... args)
+  {
+    return (*static_cast<T*>(t.object_ptr))(::std::forward<A>(args)...);
+  }
+};
+
+#endif // FUNCTION_REF_HPP
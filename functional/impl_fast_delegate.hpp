@@ -2,34 +2,166 @@
 #ifndef DELEGATE_HPP
 # define DELEGATE_HPP
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <new>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
-template <typename T> class delegate;
+// Ownership policies for functors stored on the heap, deciding what
+// copying a delegate does with them.
 
-template<class R, class ...A>
-class delegate<R (A...)>
+// Copies share the functor, counted atomically
+struct shared_store
+{
+  using count_type = ::std::atomic< ::std::size_t>;
+
+  static constexpr bool shares = true;
+
+  static void acquire(count_type& c) noexcept
+  {
+    c.fetch_add(1, ::std::memory_order_relaxed);
+  }
+
+  static bool release(count_type& c) noexcept
+  {
+    return c.fetch_sub(1, ::std::memory_order_acq_rel) == 1;
+  }
+
+  static bool unique(count_type const& c) noexcept
+  {
+    return c.load(::std::memory_order_acquire) == 1;
+  }
+};
+
+// Copies share the functor, counted non-atomically. A delegate and
+// all its copies must stay on one thread.
+struct local_store
+{
+  using count_type = ::std::size_t;
+
+  static constexpr bool shares = true;
+
+  static void acquire(count_type& c) noexcept { ++c; }
+
+  static bool release(count_type& c) noexcept { return !--c; }
+
+  static bool unique(count_type const& c) noexcept { return c == 1; }
+};
+
+// Copies clone the functor, which must then be copyable
+struct deep_copy_store
+{
+  using count_type = ::std::size_t; // always 1
+
+  static constexpr bool shares = false;
+
+  static void acquire(count_type&) noexcept { }
+
+  static bool release(count_type&) noexcept { return true; }
+
+  static bool unique(count_type const&) noexcept { return true; }
+};
+
+// Trivially copyable functors up to N bytes (and not over aligned) are
+// stored inside the delegate and copied with it, byte for byte. Others
+// go to a heap block owned as the Ownership policy says.
+//
+// Delegates compare equal when they call the same stub on the same
+// object. For an inline functor the object is its bytes, so a copy
+// compares and hashes equal to the original. A heap functor is
+// identified by its block, which copies share except under
+// deep_copy_store.
+template <typename T, ::std::size_t N = 3 * sizeof(void*),
+  class Ownership = shared_store>
+class delegate;
+
+template <typename T> class static_delegate;
+
+template<class R, class ...A, ::std::size_t N, class Ownership>
+class delegate<R (A...), N, Ownership>
 {
   using stub_ptr_type = R (*)(void*, A&&...);
 
-  delegate(void* const o, stub_ptr_type const m) noexcept :
+public:
+  using arg_tuple = ::std::tuple<A...>;
+
+  using batch_result_type = typename ::std::conditional<
+    ::std::is_void<R>{}, void, typename ::std::decay<R>::type>::type;
+
+private:
+  using batch_stub_ptr_type = void (*)(void*, arg_tuple const*,
+    ::std::size_t, batch_result_type*);
+
+  // Anything else is a functor to store. A static_delegate converts
+  // to the same object and stub instead.
+  template <typename T>
+  using enable_if_functor_t = typename ::std::enable_if<
+    !::std::is_same<delegate, typename ::std::decay<T>::type>{} &&
+    !::std::is_same<static_delegate<R (A...)>,
+      typename ::std::decay<T>::type>{}
+  >::type;
+
+  struct ops_type;
+
+  delegate(void* const o, stub_ptr_type const m,
+    ops_type const* const ops) noexcept :
     object_ptr_(o),
-    stub_ptr_(m)
+    stub_ptr_(m),
+    ops_(ops)
   {
   }
 
 public:
   delegate() = default;
 
-  delegate(delegate const&) = default;
+  delegate(delegate const& other) :
+    object_ptr_(other.object_ptr_),
+    stub_ptr_(other.stub_ptr_),
+    ops_(other.ops_)
+  {
+    if (other.stored_inline())
+    {
+      ::std::memcpy(buffer_, other.buffer_, N);
+      object_ptr_ = buffer_;
+    }
+    else if (other.stored_on_heap())
+    {
+      copy_store(other, ::std::integral_constant<bool, Ownership::shares>{});
+    }
+  }
 
-  delegate(delegate&&) = default;
+  delegate(delegate&& other) noexcept :
+    object_ptr_(other.object_ptr_),
+    stub_ptr_(other.stub_ptr_),
+    ops_(other.ops_)
+  {
+    if (other.stored_inline())
+    {
+      ::std::memcpy(buffer_, other.buffer_, N);
+      object_ptr_ = buffer_;
+    }
+    else if (other.stored_on_heap())
+    {
+      other.ops_ = nullptr;
+    }
+  }
+
+  ~delegate() { destroy_functor(); }
 
   delegate(::std::nullptr_t const) noexcept : delegate() { }
 
+  delegate(static_delegate<R (A...)> const d) noexcept :
+    object_ptr_(d.object_ptr_),
+    stub_ptr_(d.stub_ptr_)
+  {
+  }
+
   template <class C, typename =
     typename ::std::enable_if< ::std::is_class<C>{}>::type>
   explicit delegate(C const* const o) noexcept :
@@ -68,31 +200,48 @@ public:
     *this = from(object, method_ptr);
   }
 
-  template <
-    typename T,
-    typename = typename ::std::enable_if<
-      !::std::is_same<delegate, typename ::std::decay<T>::type>{}
-    >::type
-  >
-  delegate(T&& f) :
-    store_(operator new(sizeof(typename ::std::decay<T>::type)),
-      functor_deleter<typename ::std::decay<T>::type>),
-    store_size_(sizeof(typename ::std::decay<T>::type))
+  template <typename T, typename = enable_if_functor_t<T> >
+  delegate(T&& f)
   {
     using functor_type = typename ::std::decay<T>::type;
 
-    new (store_.get()) functor_type(::std::forward<T>(f));
-
-    object_ptr_ = store_.get();
+    emplace<functor_type>(::std::forward<T>(f),
+      fits_inline<functor_type>{});
+  }
 
-    stub_ptr_ = functor_stub<functor_type>;
+  delegate& operator=(delegate const& rhs)
+  {
+    if (this != &rhs)
+    {
+      *this = delegate(rhs);
+    }
 
-    deleter_ = deleter_stub<functor_type>;
+    return *this;
   }
 
-  delegate& operator=(delegate const&) = default;
+  delegate& operator=(delegate&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      destroy_functor();
+
+      object_ptr_ = rhs.object_ptr_;
+      stub_ptr_ = rhs.stub_ptr_;
+      ops_ = rhs.ops_;
+
+      if (rhs.stored_inline())
+      {
+        ::std::memcpy(buffer_, rhs.buffer_, N);
+        object_ptr_ = buffer_;
+      }
+      else if (rhs.stored_on_heap())
+      {
+        rhs.ops_ = nullptr;
+      }
+    }
 
-  delegate& operator=(delegate&&) = default;
+    return *this;
+  }
 
   template <class C>
   delegate& operator=(R (C::* const rhs)(A...))
@@ -106,35 +255,25 @@ public:
     return *this = from(static_cast<C const*>(object_ptr_), rhs);
   }
 
-  template <
-    typename T,
-    typename = typename ::std::enable_if<
-      !::std::is_same<delegate, typename ::std::decay<T>::type>{}
-    >::type
-  >
-  delegate& operator=(T&& f)
+  delegate& operator=(static_delegate<R (A...)> const d) noexcept
   {
-    using functor_type = typename ::std::decay<T>::type;
+    destroy_functor();
 
-    if ((sizeof(functor_type) > store_size_) || !store_.unique())
-    {
-      store_.reset(operator new(sizeof(functor_type)),
-        functor_deleter<functor_type>);
+    object_ptr_ = d.object_ptr_;
+    stub_ptr_ = d.stub_ptr_;
 
-      store_size_ = sizeof(functor_type);
-    }
-    else
-    {
-      deleter_(store_.get());
-    }
-
-    new (store_.get()) functor_type(::std::forward<T>(f));
+    return *this;
+  }
 
-    object_ptr_ = store_.get();
+  template <typename T, typename = enable_if_functor_t<T> >
+  delegate& operator=(T&& f)
+  {
+    using functor_type = typename ::std::decay<T>::type;
 
-    stub_ptr_ = functor_stub<functor_type>;
+    stub_ptr_ = nullptr;
 
-    deleter_ = deleter_stub<functor_type>;
+    emplace<functor_type>(::std::forward<T>(f),
+      fits_inline<functor_type>{});
 
     return *this;
   }
@@ -142,31 +281,36 @@ public:
   template <R (* const function_ptr)(A...)>
   static delegate from() noexcept
   {
-    return { nullptr, function_stub<function_ptr> };
+    return { nullptr, function_stub<function_ptr>,
+      stub_ops<function_stub<function_ptr>>() };
   }
 
   template <class C, R (C::* const method_ptr)(A...)>
   static delegate from(C* const object_ptr) noexcept
   {
-    return { object_ptr, method_stub<C, method_ptr> };
+    return { object_ptr, method_stub<C, method_ptr>,
+      stub_ops<method_stub<C, method_ptr>>() };
   }
 
   template <class C, R (C::* const method_ptr)(A...) const>
   static delegate from(C const* const object_ptr) noexcept
   {
-    return { const_cast<C*>(object_ptr), const_method_stub<C, method_ptr> };
+    return { const_cast<C*>(object_ptr), const_method_stub<C, method_ptr>,
+      stub_ops<const_method_stub<C, method_ptr>>() };
   }
 
   template <class C, R (C::* const method_ptr)(A...)>
   static delegate from(C& object) noexcept
   {
-    return { &object, method_stub<C, method_ptr> };
+    return { &object, method_stub<C, method_ptr>,
+      stub_ops<method_stub<C, method_ptr>>() };
   }
 
   template <class C, R (C::* const method_ptr)(A...) const>
   static delegate from(C const& object) noexcept
   {
-    return { const_cast<C*>(&object), const_method_stub<C, method_ptr> };
+    return { const_cast<C*>(&object), const_method_stub<C, method_ptr>,
+      stub_ops<const_method_stub<C, method_ptr>>() };
   }
 
   template <typename T>
@@ -215,7 +359,12 @@ public:
     return const_member_pair<C>(&object, method_ptr);
   }
 
-  void reset() { stub_ptr_ = nullptr; store_.reset(); }
+  void reset() noexcept
+  {
+    destroy_functor();
+
+    stub_ptr_ = nullptr;
+  }
 
   void reset_stub() noexcept { stub_ptr_ = nullptr; }
 
@@ -223,7 +372,10 @@ public:
 
   bool operator==(delegate const& rhs) const noexcept
   {
-    return (object_ptr_ == rhs.object_ptr_) && (stub_ptr_ == rhs.stub_ptr_);
+    return (stub_ptr_ == rhs.stub_ptr_) &&
+      (stored_inline() == rhs.stored_inline()) &&
+      (stored_inline() ? !::std::memcmp(buffer_, rhs.buffer_, N) :
+        object_ptr_ == rhs.object_ptr_);
   }
 
   bool operator!=(delegate const& rhs) const noexcept
@@ -231,10 +383,24 @@ public:
     return !operator==(rhs);
   }
 
+  // Inline functors, ordered by their bytes, come after the rest
   bool operator<(delegate const& rhs) const noexcept
   {
-    return (object_ptr_ < rhs.object_ptr_) ||
-      ((object_ptr_ == rhs.object_ptr_) && (stub_ptr_ < rhs.stub_ptr_));
+    if (stored_inline() != rhs.stored_inline())
+    {
+      return rhs.stored_inline();
+    }
+    else if (stored_inline())
+    {
+      auto const c(::std::memcmp(buffer_, rhs.buffer_, N));
+
+      return (c < 0) || (!c && (stub_ptr_ < rhs.stub_ptr_));
+    }
+    else
+    {
+      return (object_ptr_ < rhs.object_ptr_) ||
+        ((object_ptr_ == rhs.object_ptr_) && (stub_ptr_ < rhs.stub_ptr_));
+    }
   }
 
   bool operator==(::std::nullptr_t const) const noexcept
@@ -255,31 +421,267 @@ public:
     return stub_ptr_(object_ptr_, ::std::forward<A>(args)...);
   }
 
+  // Calls the target once for each of args[0, n), storing the results
+  // in results[0, n) (unused if R is void). The stub is dispatched
+  // once per batch and the loop inside it calls the target directly.
+  void invoke_batch(arg_tuple const* const args, ::std::size_t const n,
+    batch_result_type* const results = nullptr) const
+  {
+    static_assert(batch_args{},
+      "invoke_batch copies the arguments, which must be copyable");
+
+    assert(stub_ptr_);
+
+    if (ops_)
+    {
+      ops_->batch(object_ptr_, args, n, results);
+    }
+    else
+    {
+      // Made from a static_delegate, which has no batch stub
+      call_loop(args, n, results, ::std::index_sequence_for<A...>{},
+        ::std::is_void<R>{});
+    }
+  }
+
 private:
   friend struct ::std::hash<delegate>;
 
-  using deleter_type = void (*)(void*);
+  template <typename> friend class multicast_delegate;
 
-  void* object_ptr_;
+  template <typename> friend class static_delegate;
+
+  enum class manager_op { clone, destroy };
+
+  using manager_type = void (*)(manager_op, void*, void*);
+
+  // Per target type, so that a delegate spends one pointer on them.
+  // manage clones and destroys an owned functor and is null for the
+  // targets of from<>(), which are borrowed.
+  struct ops_type
+  {
+    manager_type manage;
+    batch_stub_ptr_type batch;
+  };
+
+  template <stub_ptr_type stub>
+  static ops_type const* stub_ops() noexcept
+  {
+    static ops_type const ops{nullptr, batch_stub_of<stub>()};
+
+    return &ops;
+  }
+
+  template <class T>
+  static ops_type const* functor_ops() noexcept
+  {
+    static ops_type const ops{manager_stub<T>,
+      batch_stub_of<functor_stub<T>>()};
+
+    return &ops;
+  }
+
+  // Copied, moved and compared as bytes, destroyed by doing nothing
+  template <class T>
+  using fits_inline = ::std::integral_constant<bool,
+    (sizeof(T) <= N) &&
+    (alignof(T) <= alignof(::std::max_align_t)) &&
+    ::std::is_trivially_copyable<T>{} &&
+    ::std::is_copy_constructible<T>{}>;
+
+  // Header of a heap block, the functor follows it
+  struct heap_block
+  {
+    explicit heap_block(::std::size_t const s) noexcept : count(1), size(s)
+    {
+    }
+
+    typename Ownership::count_type count;
+    ::std::size_t size;
+  };
+
+  // Zeroed before a functor is built in it, so the bytes past the
+  // functor never differ between equal delegates. First, so that the
+  // pointers need no padding after it.
+  alignas(::std::max_align_t) unsigned char buffer_[N];
+
+  // Points into buffer_, past the header of an owned heap block, or
+  // at a borrowed object
+  void* object_ptr_{};
   stub_ptr_type stub_ptr_{};
 
-  deleter_type deleter_;
+  // Null when empty or made from a static_delegate
+  ops_type const* ops_{};
 
-  ::std::shared_ptr<void> store_;
-  ::std::size_t store_size_;
+  static constexpr ::std::size_t functor_offset() noexcept
+  {
+    return (sizeof(heap_block) + alignof(::std::max_align_t) - 1) &
+      ~(alignof(::std::max_align_t) - 1);
+  }
+
+  static void* functor_of(heap_block* const b) noexcept
+  {
+    return reinterpret_cast<unsigned char*>(b) + functor_offset();
+  }
+
+  heap_block* store() const noexcept
+  {
+    return reinterpret_cast<heap_block*>(
+      static_cast<unsigned char*>(object_ptr_) - functor_offset());
+  }
+
+  static heap_block* allocate_block(::std::size_t const size)
+  {
+    return new (operator new(functor_offset() + size)) heap_block(size);
+  }
+
+  static void free_block(heap_block* const b) noexcept
+  {
+    b->~heap_block();
+
+    operator delete(b);
+  }
+
+  // Owned functors, inline or on the heap, as opposed to borrowed
+  // targets
+  bool owns_functor() const noexcept { return ops_ && ops_->manage; }
+
+  bool stored_inline() const noexcept
+  {
+    return owns_functor() && (object_ptr_ == buffer_);
+  }
+
+  bool stored_on_heap() const noexcept
+  {
+    return owns_functor() && (object_ptr_ != buffer_);
+  }
+
+  void destroy_functor() noexcept
+  {
+    // Inline functors are trivially destructible
+    if (stored_on_heap() && Ownership::release(store()->count))
+    {
+      ops_->manage(manager_op::destroy, object_ptr_, nullptr);
+
+      free_block(store());
+    }
+
+    ops_ = nullptr;
+  }
+
+  void copy_store(delegate const& other, ::std::true_type) noexcept
+  {
+    Ownership::acquire(other.store()->count);
+  }
+
+  void copy_store(delegate const& other, ::std::false_type)
+  {
+    auto const b(allocate_block(other.store()->size));
+
+    try
+    {
+      other.ops_->manage(manager_op::clone, functor_of(b),
+        other.object_ptr_);
+    }
+    catch (...)
+    {
+      free_block(b);
+      throw;
+    }
+
+    object_ptr_ = functor_of(b);
+  }
+
+  template <class T, typename F>
+  void emplace(F&& f, ::std::true_type)
+  {
+    destroy_functor();
+
+    ::std::memset(buffer_, 0, N);
+
+    new (buffer_) T(::std::forward<F>(f));
+
+    object_ptr_ = buffer_;
+
+    set_stubs<T>();
+  }
+
+  template <class T, typename F>
+  void emplace(F&& f, ::std::false_type)
+  {
+    static_assert(Ownership::shares || ::std::is_copy_constructible<T>{},
+      "copies of this delegate clone the functor");
+
+    heap_block* b;
+
+    // Reuse the heap block if nobody else refers to it
+    if (stored_on_heap() && (sizeof(T) <= store()->size) &&
+      Ownership::unique(store()->count))
+    {
+      b = store();
+
+      ops_->manage(manager_op::destroy, object_ptr_, nullptr);
+
+      ops_ = nullptr;
+    }
+    else
+    {
+      destroy_functor();
+
+      b = allocate_block(sizeof(T));
+    }
+
+    try
+    {
+      new (functor_of(b)) T(::std::forward<F>(f));
+    }
+    catch (...)
+    {
+      free_block(b);
+      object_ptr_ = nullptr;
+      throw;
+    }
+
+    object_ptr_ = functor_of(b);
+
+    set_stubs<T>();
+  }
 
   template <class T>
-  static void functor_deleter(void* const p)
+  void set_stubs() noexcept
   {
-    static_cast<T*>(p)->~T();
+    stub_ptr_ = functor_stub<T>;
 
-    operator delete(p);
+    ops_ = functor_ops<T>();
   }
 
   template <class T>
-  static void deleter_stub(void* const p)
+  static void manager_stub(manager_op const op, void* const dst,
+    void* const src)
   {
-    static_cast<T*>(p)->~T();
+    switch (op)
+    {
+      case manager_op::clone:
+        clone<T>(dst, src, ::std::is_copy_constructible<T>{});
+        break;
+
+      case manager_op::destroy:
+        static_cast<T*>(dst)->~T();
+        break;
+    }
+  }
+
+  template <class T>
+  static void clone(void* const dst, void* const src, ::std::true_type)
+  {
+    new (dst) T(*static_cast<T const*>(src));
+  }
+
+  // Only shared heap blocks hold non-copyable functors
+  template <class T>
+  static void clone(void*, void*, ::std::false_type)
+  {
+    assert(false);
   }
 
   template <R (*function_ptr)(A...)>
@@ -302,6 +704,96 @@ private:
       ::std::forward<A>(args)...);
   }
 
+  // The batch loops copy each argument out of a const tuple element,
+  // which a move-only parameter does not allow. Such delegates get no
+  // batch stub and cannot invoke_batch.
+  template <typename T, typename = void>
+  struct batch_arg : ::std::false_type { };
+
+  template <typename T>
+  struct batch_arg<T,
+    decltype(void(static_cast<T>(::std::declval<T const&>())))> :
+    ::std::true_type
+  {
+  };
+
+  using batch_args = ::std::is_same<
+    ::std::integer_sequence<bool, true, batch_arg<A>{}...>,
+    ::std::integer_sequence<bool, batch_arg<A>{}..., true> >;
+
+  template <stub_ptr_type stub>
+  static constexpr batch_stub_ptr_type batch_stub_of() noexcept
+  {
+    return batch_stub_of<stub>(batch_args{});
+  }
+
+  template <stub_ptr_type stub>
+  static constexpr batch_stub_ptr_type batch_stub_of(::std::true_type) noexcept
+  {
+    return batch_stub<stub>;
+  }
+
+  template <stub_ptr_type stub>
+  static constexpr batch_stub_ptr_type batch_stub_of(::std::false_type) noexcept
+  {
+    return nullptr;
+  }
+
+  // `stub` is a constant here, so it gets inlined into the loop
+  template <stub_ptr_type stub>
+  static void batch_stub(void* const object_ptr, arg_tuple const* const args,
+    ::std::size_t const n, batch_result_type* const results)
+  {
+    batch_loop<stub>(object_ptr, args, n, results,
+      ::std::index_sequence_for<A...>{}, ::std::is_void<R>{});
+  }
+
+  template <stub_ptr_type stub, ::std::size_t ...I>
+  static void batch_loop(void* const object_ptr, arg_tuple const* const args,
+    ::std::size_t const n, batch_result_type* const results,
+    ::std::index_sequence<I...>, ::std::false_type)
+  {
+    for (::std::size_t i = 0; i < n; ++i)
+    {
+      results[i] = stub(object_ptr,
+        static_cast<A>(::std::get<I>(args[i]))...);
+    }
+  }
+
+  template <stub_ptr_type stub, ::std::size_t ...I>
+  static void batch_loop(void* const object_ptr, arg_tuple const* const args,
+    ::std::size_t const n, batch_result_type*,
+    ::std::index_sequence<I...>, ::std::true_type)
+  {
+    for (::std::size_t i = 0; i < n; ++i)
+    {
+      stub(object_ptr, static_cast<A>(::std::get<I>(args[i]))...);
+    }
+  }
+
+  template <::std::size_t ...I>
+  void call_loop(arg_tuple const* const args, ::std::size_t const n,
+    batch_result_type* const results, ::std::index_sequence<I...>,
+    ::std::false_type) const
+  {
+    for (::std::size_t i = 0; i < n; ++i)
+    {
+      results[i] = stub_ptr_(object_ptr_,
+        static_cast<A>(::std::get<I>(args[i]))...);
+    }
+  }
+
+  template <::std::size_t ...I>
+  void call_loop(arg_tuple const* const args, ::std::size_t const n,
+    batch_result_type*, ::std::index_sequence<I...>,
+    ::std::true_type) const
+  {
+    for (::std::size_t i = 0; i < n; ++i)
+    {
+      stub_ptr_(object_ptr_, static_cast<A>(::std::get<I>(args[i]))...);
+    }
+  }
+
   template <typename>
   struct is_member_pair : std::false_type { };
 
@@ -342,19 +834,130 @@ private:
     return (static_cast<T*>(object_ptr)->first->*
       static_cast<T*>(object_ptr)->second)(::std::forward<A>(args)...);
   }
+
 };
 
-namespace std
+// Literal, non-owning delegate: an object pointer and a stub, made
+// only by the from<>() factories, which are constexpr. Tables of them
+// can be built at compile time and placed in read-only data:
+//
+//   static constexpr std::array<static_delegate<void(msg&)>, 2> table{{
+//     static_delegate<void(msg&)>::from<&on_ping>(),
+//     static_delegate<void(msg&)>::from<session, &session::on_data>(s)
+//   }};
+//
+// Converts to, and compares equal with, delegate made by the same
+// factory.
+template<class R, class ...A>
+class static_delegate<R (A...)>
 {
-  template <typename R, typename ...A>
-  struct hash<::delegate<R (A...)> >
+  using delegate_type = delegate<R (A...)>;
+
+  using stub_ptr_type = R (*)(void*, A&&...);
+
+  constexpr static_delegate(void* const o, stub_ptr_type const m) noexcept :
+    object_ptr_(o),
+    stub_ptr_(m)
   {
-    size_t operator()(::delegate<R (A...)> const& d) const noexcept
-    {
-      auto const seed(hash<void*>()(d.object_ptr_));
+  }
+
+public:
+  constexpr static_delegate() noexcept : static_delegate(nullptr, nullptr) { }
 
-      return hash<typename ::delegate<R (A...)>::stub_ptr_type>()(
-        d.stub_ptr_) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  template <R (* const function_ptr)(A...)>
+  static constexpr static_delegate from() noexcept
+  {
+    return { nullptr, delegate_type::template function_stub<function_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...)>
+  static constexpr static_delegate from(C* const object_ptr) noexcept
+  {
+    return { object_ptr,
+      delegate_type::template method_stub<C, method_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...) const>
+  static constexpr static_delegate from(C const* const object_ptr) noexcept
+  {
+    return { const_cast<C*>(object_ptr),
+      delegate_type::template const_method_stub<C, method_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...)>
+  static constexpr static_delegate from(C& object) noexcept
+  {
+    return { &object, delegate_type::template method_stub<C, method_ptr> };
+  }
+
+  template <class C, R (C::* const method_ptr)(A...) const>
+  static constexpr static_delegate from(C const& object) noexcept
+  {
+    return { const_cast<C*>(&object),
+      delegate_type::template const_method_stub<C, method_ptr> };
+  }
+
+  constexpr bool operator==(static_delegate const& rhs) const noexcept
+  {
+    return (object_ptr_ == rhs.object_ptr_) && (stub_ptr_ == rhs.stub_ptr_);
+  }
+
+  constexpr bool operator!=(static_delegate const& rhs) const noexcept
+  {
+    return !operator==(rhs);
+  }
+
+  constexpr explicit operator bool() const noexcept { return stub_ptr_; }
+
+  R operator()(A... args) const
+  {
+    return stub_ptr_(object_ptr_, ::std::forward<A>(args)...);
+  }
+
+private:
+  template <typename, ::std::size_t, class> friend class delegate;
+
+  void* object_ptr_;
+  stub_ptr_type stub_ptr_;
+};
+
+namespace std
+{
+  // Object pointers are aligned and stubs sit close together, so the
+  // low bits of both carry little; every input bit is mixed into
+  // every output bit (the murmur3 64 bit finalizer). An inline functor
+  // stands for the object pointer with its bytes, as in operator==.
+  template <typename R, typename ...A, size_t N, class O>
+  struct hash<::delegate<R (A...), N, O> >
+  {
+    size_t operator()(::delegate<R (A...), N, O> const& d) const noexcept
+    {
+      uint64_t h(reinterpret_cast<uintptr_t>(d.stub_ptr_));
+
+      if (d.stored_inline())
+      {
+        for (size_t i(0); i < N; i += sizeof(uint64_t))
+        {
+          uint64_t w{};
+          memcpy(&w, d.buffer_ + i,
+            N - i < sizeof(w) ? N - i : sizeof(w));
+
+          h = (h ^ w) * 0x9e3779b97f4a7c15;
+        }
+      }
+      else
+      {
+        h += uint64_t(reinterpret_cast<uintptr_t>(d.object_ptr_)) *
+          0x9e3779b97f4a7c15;
+      }
+
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccd;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53;
+      h ^= h >> 33;
+
+      return size_t(h);
     }
   };
 }
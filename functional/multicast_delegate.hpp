@@ -0,0 +1,259 @@
+#pragma once
+#ifndef MULTICAST_DELEGATE_HPP
+# define MULTICAST_DELEGATE_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "impl_fast_delegate.hpp"
+
+// Calls every connected delegate with the same arguments.
+//
+//   multicast_delegate<void(int)> changed;
+//   auto c = changed.connect(delegate<void(int)>::from<W, &W::on>(w));
+//   changed(42);
+//   changed.disconnect(c);
+//
+// Emitting walks one contiguous array of (object pointer, stub) pairs.
+// Delegates that own their functor are kept in separately allocated
+// nodes, so the functor does not move when the array grows or is
+// reordered. Connect and disconnect are O(1); disconnect moves the last
+// subscriber into the freed slot, so the call order is unspecified.
+//
+// Subscribers may connect and disconnect (themselves included) while
+// an emit is running. Those connected during an emit are first called
+// by the next one, those disconnected are not called again and are
+// destroyed once the outermost emit returns.
+
+template <typename T> class multicast_delegate;
+
+template <class R, class ...A>
+class multicast_delegate<R (A...)>
+{
+public:
+  using delegate_type = delegate<R (A...)>;
+
+  // Identifies a subscriber until it is disconnected. Disconnecting
+  // the same connection twice is an error.
+  class connection
+  {
+    friend class multicast_delegate;
+
+    explicit connection(::std::size_t const id) noexcept : id_(id) { }
+
+    ::std::size_t id_;
+  };
+
+  multicast_delegate() = default;
+
+  multicast_delegate(multicast_delegate const&) = delete;
+
+  multicast_delegate(multicast_delegate&&) = default;
+
+  multicast_delegate& operator=(multicast_delegate const&) = delete;
+
+  multicast_delegate& operator=(multicast_delegate&&) = default;
+
+  connection connect(delegate_type d)
+  {
+    assert(d);
+
+    slot s{d.object_ptr_, d.stub_ptr_};
+
+    ::std::unique_ptr<delegate_type> owner;
+
+    if (d.owns_functor())
+    {
+      owner.reset(new delegate_type(::std::move(d)));
+
+      s = slot{owner->object_ptr_, owner->stub_ptr_};
+    }
+
+    auto const id(acquire_id());
+
+    try
+    {
+      slots_.push_back(s);
+
+      try
+      {
+        infos_.push_back(slot_info{id, ::std::move(owner)});
+      }
+      catch (...)
+      {
+        slots_.pop_back();
+        throw;
+      }
+    }
+    catch (...)
+    {
+      free_ids_.push_back(id);
+      throw;
+    }
+
+    positions_[id] = slots_.size() - 1;
+
+    return connection(id);
+  }
+
+  void disconnect(connection const c)
+  {
+    auto const pos(positions_[c.id_]);
+
+    assert(pos != npos);
+
+    if (emitting_)
+    {
+      // Already pending
+      if (!slots_[pos].stub_ptr)
+      {
+        return;
+      }
+
+      dead_.push_back(c.id_);
+
+      slots_[pos].stub_ptr = nullptr;
+    }
+    else
+    {
+      erase(pos);
+    }
+  }
+
+  void clear()
+  {
+    for (auto i(infos_.size()); i; --i)
+    {
+      disconnect(connection(infos_[i - 1].id));
+    }
+  }
+
+  ::std::size_t size() const noexcept { return slots_.size() - dead_.size(); }
+
+  bool empty() const noexcept { return !size(); }
+
+  // Results of non-void subscribers are discarded. Each subscriber gets
+  // its own copy of by-value arguments.
+  void operator()(A... args)
+  {
+    emit_scope const scope(*this);
+
+    // Subscribers connected from here on wait for the next emit
+    auto const n(slots_.size());
+
+    for (::std::size_t i = 0; i != n; ++i)
+    {
+      auto const s(slots_[i]);
+
+      if (s.stub_ptr)
+      {
+        s.stub_ptr(s.object_ptr, static_cast<A>(args)...);
+      }
+    }
+  }
+
+private:
+  using stub_ptr_type = R (*)(void*, A&&...);
+
+  static constexpr ::std::size_t npos = ~::std::size_t(0);
+
+  // What emitting reads, nothing else
+  struct slot
+  {
+    void* object_ptr;
+    stub_ptr_type stub_ptr;
+  };
+
+  struct slot_info
+  {
+    ::std::size_t id;
+    ::std::unique_ptr<delegate_type> owner;
+  };
+
+  struct emit_scope
+  {
+    explicit emit_scope(multicast_delegate& m) noexcept : m(m)
+    {
+      ++m.emitting_;
+    }
+
+    ~emit_scope()
+    {
+      if (!--m.emitting_)
+      {
+        m.erase_dead();
+      }
+    }
+
+    multicast_delegate& m;
+  };
+
+  ::std::vector<slot> slots_;
+  // Parallel to slots_
+  ::std::vector<slot_info> infos_;
+
+  // Slot index by connection id, npos for unused ids
+  ::std::vector< ::std::size_t> positions_;
+  ::std::vector< ::std::size_t> free_ids_;
+
+  // Connections disconnected while emitting
+  ::std::vector< ::std::size_t> dead_;
+  ::std::size_t emitting_{};
+
+  ::std::size_t acquire_id()
+  {
+    if (free_ids_.empty())
+    {
+      positions_.push_back(npos);
+
+      // erase() must not throw
+      free_ids_.reserve(positions_.size());
+
+      return positions_.size() - 1;
+    }
+
+    auto const id(free_ids_.back());
+
+    free_ids_.pop_back();
+
+    return id;
+  }
+
+  void erase(::std::size_t const pos) noexcept
+  {
+    auto const id(infos_[pos].id);
+    auto const last(slots_.size() - 1);
+
+    if (pos != last)
+    {
+      slots_[pos] = slots_[last];
+      infos_[pos] = ::std::move(infos_[last]);
+
+      positions_[infos_[pos].id] = pos;
+    }
+
+    slots_.pop_back();
+    infos_.pop_back();
+
+    positions_[id] = npos;
+    free_ids_.push_back(id);
+  }
+
+  void erase_dead() noexcept
+  {
+    for (auto const id: dead_)
+    {
+      erase(positions_[id]);
+    }
+
+    dead_.clear();
+  }
+};
+
+template <class R, class ...A>
+constexpr ::std::size_t multicast_delegate<R (A...)>::npos;
+
+#endif // MULTICAST_DELEGATE_HPP
@@ -2,173 +2,770 @@
 #include <memory>
 #include <type_traits>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
 #include <string>
-#include <functional> // Only for std::bind and std::mem_fn
+#include <tuple>
+#include <utility>
+#include <functional> // Only for std::reference_wrapper
 
 /*
  * Understanding the mechanics behind working of std::function
  * For my blog series: http://templated-thoughts.blogspot.in/2016/06/what-you-need-not-know-about-stdfunction.html
+ *
+ * There is no virtual base class anymore. A Function holds an
+ * invoker pointer which is called directly (like the stub_ptr_ of
+ * delegate) and a pointer to the per type operations: one manager
+ * function doing clone/move/destroy and the batch invoker. Trivial
+ * inline targets have no manager and are copied with a memcpy.
  */
 
 namespace detail {
 
-  template <typename Ret, typename... Args>
-  class function_impl_base
-  {
-  public:
-    virtual Ret operator()(Args&&... args) = 0;
-    virtual function_impl_base* clone() = 0;
-    virtual ~function_impl_base() {}
-  };
+  // Bytes of inline storage a Function gets unless told otherwise.
+  // Enough for a function pointer, a member function pointer or a
+  // lambda capturing two pointers. With the two code pointers a
+  // Function is then 32 bytes on LP64, as std::function is, and
+  // copying a table of them moves no more memory; anything from 17 to
+  // 32 bytes would take it to 48.
+  constexpr std::size_t default_inline_size = 2 * sizeof(void*);
 
-  template <typename Signature, typename Functor> class func_impl;
+  enum class manager_op { clone, move, destroy };
+
+  // The func_impl specializations are the call policies: how to
+  // invoke a stored callable of a given kind.
+  template <typename Signature, typename Functor> struct func_impl;
 
   // Specialization for Function pointers
   template <typename Ret, typename... Args>
-  class func_impl<Ret(Args...), Ret(*)(Args...)> final 
-	    : public function_impl_base<Ret, Args...>
+  struct func_impl<Ret(Args...), Ret(*)(Args...)>
   {
-  public:
     using callable_t = Ret(*)(Args...);
 
-    // The need for constructor tag removed in this version
-    func_impl(callable_t callable): callable_(std::move(callable))
-    {}
+    static Ret call(callable_t& callable, Args&&... args)
+    {
+      return callable(std::forward<Args>(args)...);
+    }
+  };
+
+  // Specialization for Functors
+  template <typename Functor, typename Ret, typename... Args>
+  struct func_impl<Ret(Args...), Functor>
+  {
+    using callable_t = Functor;
+
+    static Ret call(callable_t& callable, Args&&... args)
+    {
+      return callable(std::forward<Args>(args)...);
+    }
+  };
 
-    func_impl(const func_impl&) = default;
+  template <typename T> struct is_reference_wrapper : std::false_type {};
 
-    func_impl& operator=(func_impl&) = default;
+  template <typename T>
+  struct is_reference_wrapper<std::reference_wrapper<T>> : std::true_type {};
+
+  // Specialization for Member function (and data) pointers.
+  // The object argument is never copied: it is bound by reference,
+  // unwrapped from a reference_wrapper or dereferenced if it is a
+  // pointer or smart pointer.
+  template <typename Class, typename Member, typename Ret, typename... Args>
+  struct func_impl<Ret(Args...), Member Class::*>
+  {
+    using callable_t = Member (Class::*);
 
-    Ret operator()(Args&&... args)
+    static Ret call(callable_t& callable, Args&&... args)
     {
-      return callable_(std::forward<Args>(args)...);
+      return call_(callable, std::forward<Args>(args)...);
     }
 
-    func_impl* clone()
+    template <typename ClassType, typename... Params>
+    static Ret call_(callable_t& callable, ClassType&& obj, Params&&... args)
     {
-      return (new func_impl(*this));
+      return invoke(std::is_member_function_pointer<callable_t>{}, callable,
+          object(std::forward<ClassType>(obj), object_kind<ClassType>{}),
+          std::forward<Params>(args)...);
     }
 
   private:
-    callable_t callable_;
+    // 0: the object itself, 1: a reference_wrapper to it,
+    // 2: anything that dereferences to it
+    template <typename T>
+    using object_kind = std::integral_constant<int,
+      std::is_base_of<Class, typename std::decay<T>::type>::value ? 0 :
+      is_reference_wrapper<typename std::decay<T>::type>::value ? 1 : 2>;
+
+    template <typename T>
+    static T&& object(T&& obj, std::integral_constant<int, 0>)
+    {
+      return std::forward<T>(obj);
+    }
+
+    template <typename T>
+    static decltype(auto) object(T&& obj, std::integral_constant<int, 1>)
+    {
+      return obj.get();
+    }
+
+    template <typename T>
+    static decltype(auto) object(T&& obj, std::integral_constant<int, 2>)
+    {
+      return *std::forward<T>(obj);
+    }
+
+    template <typename Obj, typename... Params>
+    static Ret invoke(std::true_type, callable_t& callable,
+                      Obj&& obj, Params&&... args)
+    {
+      return (std::forward<Obj>(obj).*callable)(std::forward<Params>(args)...);
+    }
+
+    template <typename Obj>
+    static Ret invoke(std::false_type, callable_t& callable, Obj&& obj)
+    {
+      return std::forward<Obj>(obj).*callable;
+    }
   };
 
-  // Specialization for Functors
-  template <typename Functor, typename Ret, typename... Args>
-  class func_impl<Ret(Args...), Functor>
-	    : public function_impl_base<Ret, Args...>
+  // Whether a Callable is kept in an inline buffer of InlineSize
+  // bytes. Types whose move can throw always go to the heap, so
+  // that relocating an inline target can never fail.
+  template <typename Callable, std::size_t InlineSize>
+  struct stored_inline : std::integral_constant<bool,
+      sizeof(Callable) <= InlineSize &&
+      alignof(Callable) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible<Callable>::value>
+  {};
+
+  // Inline targets which need neither a copy constructor nor a
+  // destructor to run get no manager at all: they are copied and
+  // moved with a memcpy of the buffer and destroying them is a no-op.
+  template <typename Callable, std::size_t InlineSize>
+  struct stored_trivially : std::integral_constant<bool,
+      stored_inline<Callable, InlineSize>::value &&
+      std::is_trivially_copyable<Callable>::value &&
+      std::is_trivially_destructible<Callable>::value>
+  {};
+
+  // Allocator type used when none is given: plain new/delete
+  struct no_alloc {};
+
+  // Where the callable lives: directly in the storage or behind a
+  // pointer kept in the storage.
+  template <typename Callable, bool Inline, typename Alloc = no_alloc>
+  struct func_holder;
+
+  // Inline targets never touch the allocator
+  template <typename Callable, typename Alloc>
+  struct func_holder<Callable, true, Alloc>
   {
-  public:
-    using callable_t = Functor;
+    static Callable& get(void* storage) noexcept
+    {
+      return *static_cast<Callable*>(storage);
+    }
+
+    template <typename... CArgs>
+    static void create(void* storage, const Alloc&, CArgs&&... cargs)
+    {
+      new (storage) Callable(std::forward<CArgs>(cargs)...);
+    }
+
+    static void clone(void* dst, void* src)
+    {
+      new (dst) Callable(get(src));
+    }
 
-    func_impl(Functor callable): callable_(std::move(callable))
-    {}
+    static void destroy(void* storage) noexcept
+    {
+      get(storage).~Callable();
+    }
 
-    func_impl(const func_impl&) = default;
-    func_impl& operator=(func_impl&) = default;
+    static void move(void* dst, void* src) noexcept
+    {
+      new (dst) Callable(std::move(get(src)));
+      destroy(src);
+    }
 
-    Ret operator()(Args&&... args)
+    // Replaces the target with another one of the same type.
+    // If that throws the storage is left empty.
+    template <typename... CArgs>
+    static void recreate(void* storage, CArgs&&... cargs)
     {
-      return callable_(std::forward<Args>(args)...);
+      destroy(storage);
+      new (storage) Callable(std::forward<CArgs>(cargs)...);
     }
+  };
 
-    func_impl* clone()
+  template <typename Callable>
+  struct func_holder<Callable, false, no_alloc>
+  {
+    static Callable& get(void* storage) noexcept
     {
-      return (new func_impl(*this));
+      return **static_cast<Callable**>(storage);
+    }
+
+    template <typename... CArgs>
+    static void create(void* storage, const no_alloc&, CArgs&&... cargs)
+    {
+      void* p = allocate();
+      try {
+        new (p) Callable(std::forward<CArgs>(cargs)...);
+      } catch (...) {
+        deallocate(p);
+        throw;
+      }
+      *static_cast<Callable**>(storage) = static_cast<Callable*>(p);
+    }
+
+    static void clone(void* dst, void* src)
+    {
+      create(dst, no_alloc(), get(src));
+    }
+
+    static void destroy(void* storage) noexcept
+    {
+      Callable* p = &get(storage);
+      p->~Callable();
+      deallocate(p);
+    }
+
+    // Only the pointer changes hands
+    static void move(void* dst, void* src) noexcept
+    {
+      *static_cast<Callable**>(dst) = &get(src);
+    }
+
+    // Replaces the target with another one of the same type, in the
+    // same heap block. If that throws the block is freed.
+    template <typename... CArgs>
+    static void recreate(void* storage, CArgs&&... cargs)
+    {
+      Callable* p = &get(storage);
+      p->~Callable();
+      try {
+        new (p) Callable(std::forward<CArgs>(cargs)...);
+      } catch (...) {
+        deallocate(p);
+        throw;
+      }
     }
 
   private:
-      callable_t callable_;
+    // Raw storage, so that a block can be freed without an object in
+    // it. Over-aligned callables get the aligned operator new.
+#ifdef __cpp_aligned_new
+    using over_aligned = std::integral_constant<bool,
+      (alignof(Callable) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)>;
+
+    static void* allocate()
+    {
+      return allocate(over_aligned{});
+    }
+
+    static void* allocate(std::true_type)
+    {
+      return ::operator new(sizeof(Callable),
+                            std::align_val_t(alignof(Callable)));
+    }
+
+    static void* allocate(std::false_type)
+    {
+      return ::operator new(sizeof(Callable));
+    }
+
+    static void deallocate(void* p) noexcept
+    {
+      deallocate(p, over_aligned{});
+    }
+
+    static void deallocate(void* p, std::true_type) noexcept
+    {
+      ::operator delete(p, std::align_val_t(alignof(Callable)));
+    }
+
+    static void deallocate(void* p, std::false_type) noexcept
+    {
+      ::operator delete(p);
+    }
+#else
+    static void* allocate()
+    {
+      return ::operator new(sizeof(Callable));
+    }
+
+    static void deallocate(void* p) noexcept
+    {
+      ::operator delete(p);
+    }
+#endif
   };
 
-  // Specialization for Member function pointers
-  // Leveraging the use of mem_fn
-  template <typename Class, typename Member, typename Ret, typename... Args>
-  class func_impl<Ret(Args...), Member Class::*>
-	    : public function_impl_base<Ret, Args...>
+  // Heap target obtained from a user supplied allocator. The
+  // allocator is kept next to the callable so that clones come from
+  // (and everything goes back to) the same place.
+  template <typename Callable, typename Alloc>
+  struct func_holder<Callable, false, Alloc>
+  {
+    struct node;
+    using node_alloc_t =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_alloc_t>;
+
+    // Derives from the allocator so that a stateless one takes no room
+    struct node : node_alloc_t
+    {
+      template <typename... CArgs>
+      node(const node_alloc_t& a, CArgs&&... cargs):
+        node_alloc_t(a), callable(std::forward<CArgs>(cargs)...)
+      {}
+
+      node_alloc_t& alloc() noexcept { return *this; }
+
+      Callable callable;
+    };
+
+    static node*& node_ptr(void* storage) noexcept
+    {
+      return *static_cast<node**>(storage);
+    }
+
+    static Callable& get(void* storage) noexcept
+    {
+      return node_ptr(storage)->callable;
+    }
+
+    template <typename... CArgs>
+    static void create(void* storage, const Alloc& alloc, CArgs&&... cargs)
+    {
+      node_alloc_t a(alloc);
+      node* n = node_traits::allocate(a, 1);
+      try {
+        new (n) node(a, std::forward<CArgs>(cargs)...);
+      } catch (...) {
+        node_traits::deallocate(a, n, 1);
+        throw;
+      }
+      node_ptr(storage) = n;
+    }
+
+    static void clone(void* dst, void* src)
+    {
+      create(dst, node_ptr(src)->alloc(), get(src));
+    }
+
+    static void destroy(void* storage) noexcept
+    {
+      node* n = node_ptr(storage);
+      node_alloc_t a(std::move(n->alloc()));
+      n->~node();
+      node_traits::deallocate(a, n, 1);
+    }
+
+    static void move(void* dst, void* src) noexcept
+    {
+      node_ptr(dst) = node_ptr(src);
+    }
+  };
+
+  // What invoke_batch writes: nothing for void, else the decayed Ret
+  template <typename Ret>
+  using batch_result_t = typename std::conditional<std::is_void<Ret>::value,
+        void, typename std::decay<Ret>::type>::type;
+
+  // invoke_batch passes each argument as a copy of a const tuple
+  // element, which a move-only parameter does not allow
+  template <typename T, typename = void>
+  struct batch_arg : std::false_type {};
+
+  template <typename T>
+  struct batch_arg<T, decltype(void(static_cast<T>(std::declval<const T&>())))>
+    : std::true_type {};
+
+  template <typename... Args>
+  using batch_args = std::is_same<
+    std::integer_sequence<bool, true, batch_arg<Args>::value...>,
+    std::integer_sequence<bool, batch_arg<Args>::value..., true>>;
+
+  // Everything about a target type except the call itself
+  template <typename Signature> struct func_ops;
+
+  template <typename Ret, typename... Args>
+  struct func_ops<Ret(Args...)>
+  {
+    using manager_t = void (*)(manager_op, void*, void*);
+    using batch_t = void (*)(void*, const std::tuple<Args...>*, std::size_t,
+                             batch_result_t<Ret>*);
+
+    // Null for trivially stored targets
+    manager_t manage;
+    // Null when the arguments cannot be batched
+    batch_t batch;
+
+    // Used by empty Functions, so that ops are never null
+    static const func_ops* empty() noexcept
+    {
+      static const func_ops ops = { nullptr, nullptr };
+      return &ops;
+    }
+  };
+
+  template <typename Signature, typename Callable,
+            std::size_t InlineSize, bool Copyable, typename Alloc>
+  struct func_manager;
+
+  template <typename Ret, typename... Args, typename Callable,
+            std::size_t InlineSize, bool Copyable, typename Alloc>
+  struct func_manager<Ret(Args...), Callable, InlineSize, Copyable, Alloc>
+  {
+    using holder = func_holder<Callable,
+                               stored_inline<Callable, InlineSize>::value,
+                               Alloc>;
+    using policy = func_impl<Ret(Args...), Callable>;
+
+    using arg_tuple = std::tuple<Args...>;
+    using result_t = batch_result_t<Ret>;
+
+    static const func_ops<Ret(Args...)>* ops() noexcept
+    {
+      static const func_ops<Ret(Args...)> ops = {
+        stored_trivially<Callable, InlineSize>::value ? nullptr : &manage,
+        batch_ptr(batch_args<Args...>{})
+      };
+      return &ops;
+    }
+
+    // Only instantiates batch where it compiles
+    static constexpr typename func_ops<Ret(Args...)>::batch_t
+    batch_ptr(std::true_type) noexcept
+    {
+      return &batch;
+    }
+
+    static constexpr typename func_ops<Ret(Args...)>::batch_t
+    batch_ptr(std::false_type) noexcept
+    {
+      return nullptr;
+    }
+
+    static Ret invoke(void* storage, Args&&... args)
+    {
+      return policy::call(holder::get(storage), std::forward<Args>(args)...);
+    }
+
+    // The whole loop runs here where the callable type is known, so
+    // a simple target is inlined into it and can be vectorized.
+    static void batch(void* storage, const arg_tuple* args, std::size_t n,
+                      result_t* results)
+    {
+      batch_loop(holder::get(storage), args, n, results,
+                 std::index_sequence_for<Args...>{}, std::is_void<Ret>{});
+    }
+
+    template <std::size_t... I>
+    static void batch_loop(Callable& callable, const arg_tuple* args,
+                           std::size_t n, result_t* results,
+                           std::index_sequence<I...>, std::false_type)
+    {
+      for (std::size_t i = 0; i < n; ++i) {
+        results[i] = policy::call(callable,
+            static_cast<Args>(std::get<I>(args[i]))...);
+      }
+    }
+
+    template <std::size_t... I>
+    static void batch_loop(Callable& callable, const arg_tuple* args,
+                           std::size_t n, result_t*,
+                           std::index_sequence<I...>, std::true_type)
+    {
+      for (std::size_t i = 0; i < n; ++i) {
+        policy::call(callable, static_cast<Args>(std::get<I>(args[i]))...);
+      }
+    }
+
+    static void manage(manager_op op, void* dst, void* src)
+    {
+      switch (op) {
+      case manager_op::clone:
+        clone(dst, src, std::integral_constant<bool, Copyable>{});
+        break;
+      case manager_op::move:
+        holder::move(dst, src);
+        break;
+      case manager_op::destroy:
+        holder::destroy(dst);
+        break;
+      }
+    }
+
+    static void clone(void* dst, void* src, std::true_type)
+    {
+      holder::clone(dst, src);
+    }
+
+    // Never asked for by UniqueFunction. Keeps move-only callables
+    // from needing a copy constructor.
+    static void clone(void*, void*, std::false_type)
+    {
+      assert (false);
+    }
+  };
+
+  // Ownership of the type erased target shared by Function and
+  // UniqueFunction: invoker, per type ops, inline buffer.
+  // Copying is left to Function.
+  template <typename Signature, std::size_t InlineSize, bool Copyable>
+  class function_storage;
+
+  template <typename Ret, typename... Args, std::size_t InlineSize,
+            bool Copyable>
+  class function_storage<Ret(Args...), InlineSize, Copyable>
   {
   public:
-    using callable_t = Member (Class::*);
+    using invoker_t = Ret (*)(void*, Args&&...);
+    using ops_t = func_ops<Ret(Args...)>;
+    using arg_tuple = std::tuple<Args...>;
 
-    func_impl(callable_t callable): callable_(std::move(callable))
-    {}
+    // User provided, so that value initialization leaves storage_
+    // alone rather than zeroing it
+    function_storage() noexcept {}
 
-    func_impl(const func_impl&) = default;
-    func_impl& operator=(func_impl&) = default;
+    function_storage(function_storage&& other) noexcept
+    {
+      take(other);
+    }
 
-    Ret operator()(Args&&... args)
+    function_storage& operator=(function_storage&& other) noexcept
     {
-      return call(std::forward<Args>(args)...);
+      if (this != &other) {
+        reset();
+        take(other);
+      }
+      return *this;
     }
 
-    template <typename ClassType, typename... Params>
-    Ret call(ClassType obj, Params&&... args)
+    ~function_storage()
     {
-      return std::mem_fn(callable_)(obj, std::forward<Params>(args)...);
+      reset();
     }
 
-    func_impl* clone()
+    Ret operator()(Args... args)
     {
-      return (new func_impl(*this));
+      assert (invoker_);
+      return invoker_(&storage_, std::forward<Args>(args)...);
     }
 
-  private:
-    callable_t callable_;
+    // Calls the target once for each of args[0, n) and stores the
+    // results in results[0, n) (which may be null if Ret is void).
+    // Unlike a loop over operator() the type erased dispatch is
+    // done once for the whole batch.
+    void invoke_batch(const arg_tuple* args, std::size_t n,
+                      batch_result_t<Ret>* results = nullptr)
+    {
+      static_assert(batch_args<Args...>::value,
+          "invoke_batch copies the arguments, which must be copyable");
+      assert (invoker_);
+      ops_->batch(&storage_, args, n, results);
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return invoker_ != nullptr;
+    }
+
+  protected:
+    template <typename Callable, typename F, typename Alloc = no_alloc>
+    void emplace(F&& f, const Alloc& alloc = Alloc())
+    {
+      using manager = func_manager<Ret(Args...), Callable,
+                                   InlineSize, Copyable, Alloc>;
+      manager::holder::create(&storage_, alloc, std::forward<F>(f));
+      invoker_ = &manager::invoke;
+      ops_ = manager::ops();
+    }
+
+    // Assignment of a new target. When it has the same type as the
+    // current one (same ops) the storage, inline or heap, is
+    // reused. Otherwise the old target goes first, so a new inline
+    // one is simply constructed in the buffer.
+    template <typename Callable, typename F>
+    void replace(F&& f)
+    {
+      using manager = func_manager<Ret(Args...), Callable,
+                                   InlineSize, Copyable, no_alloc>;
+      if (ops_ == manager::ops()) {
+        try {
+          manager::holder::recreate(&storage_, std::forward<F>(f));
+        } catch (...) {
+          invoker_ = nullptr;
+          ops_ = ops_t::empty();
+          throw;
+        }
+        return;
+      }
+      reset();
+      emplace<Callable>(std::forward<F>(f));
+    }
+
+    // The bytes are copied before ops_ is looked at, so a trivial
+    // target (and an empty one, whose bytes are unused) never waits
+    // on that load; a clone overwrites them.
+    void copy_from(const function_storage& other)
+    {
+      std::memcpy(storage_, other.storage_, sizeof(storage_));
+      if (other.ops_->manage) {
+        other.ops_->manage(manager_op::clone, &storage_,
+                           const_cast<unsigned char*>(other.storage_));
+      }
+      invoker_ = other.invoker_;
+      ops_ = other.ops_;
+    }
+
+    void reset() noexcept
+    {
+      if (ops_->manage) ops_->manage(manager_op::destroy, &storage_, nullptr);
+      invoker_ = nullptr;
+      ops_ = ops_t::empty();
+    }
+
+    void take(function_storage& other) noexcept
+    {
+      if (!other.invoker_) return;
+      if (other.ops_->manage) {
+        other.ops_->manage(manager_op::move, &storage_, &other.storage_);
+      } else {
+        std::memcpy(storage_, other.storage_, sizeof(storage_));
+      }
+      invoker_ = other.invoker_;
+      ops_ = other.ops_;
+      other.invoker_ = nullptr;
+      other.ops_ = ops_t::empty();
+    }
+
+  protected:
+    invoker_t invoker_ = nullptr;
+    const ops_t* ops_ = ops_t::empty();
+    alignas(std::max_align_t) unsigned char
+      storage_[InlineSize < sizeof(void*) ? sizeof(void*) : InlineSize];
   };
 
 }
 
-template <typename> class Function;
+// InlineSize is the number of bytes reserved inside the Function for
+// the type erased target. Targets which do not fit are heap allocated.
+template <typename Signature,
+          std::size_t InlineSize = detail::default_inline_size>
+class Function;
 
-template <typename Ret, typename... Args>
-class Function<Ret(Args...)> 
+template <typename Ret, typename... Args, std::size_t InlineSize>
+class Function<Ret(Args...), InlineSize>
+  : public detail::function_storage<Ret(Args...), InlineSize, true>
 {
 public:
-  using implementation = detail::function_impl_base<Ret, Args...>;
   using call_signature = Ret(Args...);
 
+  template <typename Callable>
+  using enable_if_callable_t = typename std::enable_if<
+    !std::is_same<Function, typename std::decay<Callable>::type>::value
+  >::type;
+
   //Default constructor
   Function() = default;
 
   // Copy constructor
-  Function(const Function& other)
+  Function(const Function& other):
+    detail::function_storage<Ret(Args...), InlineSize, true>()
   {
-    this->impl_base_.reset(other.impl_base_->clone());
+    this->copy_from(other);
   }
 
+  Function(Function&&) noexcept = default;
+
   // Copy Assignment
-  Function& operator=(Function other)
+  Function& operator=(const Function& other)
   {
-    this->impl_base_.reset(other.impl_base_.release());
+    if (this != &other) {
+      Function tmp(other);
+      *this = std::move(tmp);
+    }
     return *this;
   }
 
-  template <typename Callable>
+  Function& operator=(Function&&) noexcept = default;
+
+  template <typename Callable, typename = enable_if_callable_t<Callable>>
   Function& operator=(Callable cb)
   {
-    this->impl_base_ = 
-      std::make_unique<detail::func_impl<call_signature, Callable>>(std::move(cb));
+    this->template replace<Callable>(std::move(cb));
     return *this;
   }
 
   // constructor
-  template <typename Callable>
-  Function(Callable f): // Requires callable be copyable
-    impl_base_(std::make_unique<detail::func_impl<call_signature, Callable>>(std::move(f)))
+  template <typename Callable, typename = enable_if_callable_t<Callable>>
+  Function(Callable f) // Requires callable be copyable
   {
+    this->template emplace<Callable>(std::move(f));
   }
 
-  Ret operator()(Args&&... args)
+  // Allocator extended constructor. A heap allocated target, and
+  // every copy of it, is obtained from `alloc`.
+  // Works with std::pmr::polymorphic_allocator too.
+  template <typename Alloc, typename Callable,
+            typename = enable_if_callable_t<Callable>>
+  Function(std::allocator_arg_t, const Alloc& alloc, Callable f)
   {
-    assert (impl_base_.get());
-    return (*impl_base_)(std::forward<Args>(args)...);
+    this->template emplace<Callable>(std::move(f), alloc);
   }
 
-  explicit operator bool() const noexcept
+  template <typename Callable, typename Alloc,
+            typename = enable_if_callable_t<Callable>>
+  void assign(Callable f, const Alloc& alloc)
   {
-    return impl_base_ != nullptr;
+    this->reset();
+    this->template emplace<Callable>(std::move(f), alloc);
   }
+};
+
+// Move-only sibling of Function. The target only needs to be
+// movable, so lambdas capturing a unique_ptr can be stored.
+template <typename Signature,
+          std::size_t InlineSize = detail::default_inline_size>
+class UniqueFunction;
+
+template <typename Ret, typename... Args, std::size_t InlineSize>
+class UniqueFunction<Ret(Args...), InlineSize>
+  : public detail::function_storage<Ret(Args...), InlineSize, false>
+{
+public:
+  using call_signature = Ret(Args...);
 
-private:
-  std::unique_ptr<implementation> impl_base_ = nullptr;
+  template <typename Callable>
+  using enable_if_callable_t = typename std::enable_if<
+    !std::is_same<UniqueFunction, typename std::decay<Callable>::type>::value
+  >::type;
+
+  UniqueFunction() = default;
+
+  UniqueFunction(UniqueFunction&&) noexcept = default;
+  UniqueFunction& operator=(UniqueFunction&&) noexcept = default;
+
+  template <typename Callable, typename = enable_if_callable_t<Callable>>
+  UniqueFunction& operator=(Callable cb)
+  {
+    this->template replace<Callable>(std::move(cb));
+    return *this;
+  }
+
+  template <typename Callable, typename = enable_if_callable_t<Callable>>
+  UniqueFunction(Callable f)
+  {
+    this->template emplace<Callable>(std::move(f));
+  }
+
+  template <typename Alloc, typename Callable,
+            typename = enable_if_callable_t<Callable>>
+  UniqueFunction(std::allocator_arg_t, const Alloc& alloc, Callable f)
+  {
+    this->template emplace<Callable>(std::move(f), alloc);
+  }
 };
@@ -0,0 +1,59 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include "my_function.hpp"
+#include "impl_fast_delegate.hpp"
+
+// Parameter kinds invoke_batch has to leave alone: a move-only
+// parameter cannot be copied out of the argument tuples, but the
+// wrappers must still build and call normally.
+
+static int sink(std::unique_ptr<int> p) { return *p; }
+
+int main()
+{
+  Function<int(std::unique_ptr<int>)> f([](std::unique_ptr<int> p) {
+    return *p + 1;
+  });
+  assert(f(std::make_unique<int>(1)) == 2);
+  auto g = f;
+  assert(g(std::make_unique<int>(2)) == 3);
+
+  UniqueFunction<void(std::unique_ptr<int>)> u(
+    [](std::unique_ptr<int> p) { assert(*p == 3); });
+  u(std::make_unique<int>(3));
+
+  delegate<int(std::unique_ptr<int>)> d([](std::unique_ptr<int> p) {
+    return *p * 2;
+  });
+  assert(d(std::make_unique<int>(4)) == 8);
+  auto s = delegate<int(std::unique_ptr<int>)>::from<&sink>();
+  assert(s(std::make_unique<int>(5)) == 5);
+
+  // Rvalue reference and const reference parameters still batch
+  Function<int(std::string&&)> r([](std::string&& x) {
+    return int(x.size());
+  });
+  std::string moved("ab");
+  std::tuple<std::string&&> rargs[] = {
+    std::forward_as_tuple(std::move(moved))
+  };
+  int rres[1];
+  r.invoke_batch(rargs, 1, rres);
+  assert(rres[0] == 2);
+
+  delegate<int(const std::string&)> c([](const std::string& x) {
+    return int(x.size());
+  });
+  const std::string text("abc");
+  std::tuple<const std::string&> cargs[] = { std::tie(text) };
+  int cres[1];
+  c.invoke_batch(cargs, 1, cres);
+  assert(cres[0] == 3);
+
+  std::cout << "Function and delegate with move-only parameters: ok"
+            << std::endl;
+  return 0;
+}
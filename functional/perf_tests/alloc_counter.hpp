@@ -0,0 +1,85 @@
+#pragma once
+#ifndef ALLOC_COUNTER_HPP
+# define ALLOC_COUNTER_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef __GLIBC__
+# include <malloc.h> // malloc_usable_size
+#endif
+
+// Replaces the global operator new/delete so that benchmarks can
+// count the allocations and live heap bytes of the calling thread.
+// Include it from exactly one translation unit.
+
+namespace alloc_counter
+{
+  inline std::size_t& count() noexcept
+  {
+    static thread_local std::size_t n = 0;
+    return n;
+  }
+
+  inline std::ptrdiff_t& live() noexcept
+  {
+    static thread_local std::ptrdiff_t n = 0;
+    return n;
+  }
+
+  // Number of global operator new calls made by this thread so far
+  inline std::size_t allocations() noexcept { return count(); }
+
+  // Heap bytes allocated minus freed by this thread, malloc overhead
+  // included. Always 0 where it cannot be measured.
+  inline std::ptrdiff_t live_bytes() noexcept { return live(); }
+
+  inline std::ptrdiff_t usable_size(void* p) noexcept
+  {
+#ifdef __GLIBC__
+    return static_cast<std::ptrdiff_t>(malloc_usable_size(p));
+#else
+    (void)p;
+    return 0;
+#endif
+  }
+
+// GCC inlines these into the callers, sees free() on a pointer from
+// operator new and warns
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+  inline void free(void* p) noexcept
+  {
+    if (p) live() -= usable_size(p);
+    std::free(p);
+  }
+}
+
+void* operator new(std::size_t n)
+{
+  ++alloc_counter::count();
+  if (void* p = std::malloc(n ? n : 1)) {
+    alloc_counter::live() += alloc_counter::usable_size(p);
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  alloc_counter::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  alloc_counter::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+# pragma GCC diagnostic pop
+#endif
+
+#endif // ALLOC_COUNTER_HPP
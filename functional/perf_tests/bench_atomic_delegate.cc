@@ -0,0 +1,110 @@
+#include "benchmark/benchmark.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "../atomic_delegate.hpp"
+
+// 1 to 32 threads calling a routing callback while one more thread
+// replaces it every millisecond.
+
+struct Router
+{
+  int operator()(int key) const { return (key * mul_ + add_) & 1023; }
+
+  int mul_;
+  int add_;
+  char pad_[48]; // too big for the inline buffer, so every swap allocates
+};
+
+using Route = int(int);
+
+// Replaces the target at 1 kHz until stopped
+class Writer
+{
+public:
+  template <typename Store>
+  void start(Store store)
+  {
+    stop_ = false;
+    swaps_ = 0;
+    thread_ = std::thread([this, store] {
+      auto next = std::chrono::steady_clock::now();
+      for (int i = 1; !stop_.load(std::memory_order_relaxed); ++i) {
+        store(Router{i % 7 + 1, i, {}});
+        ++swaps_;
+        next += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(next);
+      }
+    });
+  }
+
+  long stop()
+  {
+    stop_ = true;
+    thread_.join();
+    return swaps_;
+  }
+
+private:
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  long swaps_ = 0;
+};
+
+static Writer writer;
+
+template <typename Target, typename Store>
+static void run_readers(benchmark::State& state, const Target& target,
+  Store store)
+{
+  if (state.thread_index() == 0) writer.start(store);
+  int key = state.thread_index();
+  long sum = 0;
+  while (state.KeepRunning()) {
+    sum += target(key++);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    state.counters["swaps"] = static_cast<double>(writer.stop());
+  }
+}
+
+static void BM_atomic_delegate_call(benchmark::State& state)
+{
+  static atomic_delegate<Route> route(Router{1, 0, {}});
+  run_readers(state, route,
+    [](Router r) { route.store(r); });
+}
+
+// The alternative: a mutex taken around every call
+struct LockedDelegate
+{
+  int operator()(int key) const
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return target_(key);
+  }
+
+  void store(delegate<Route> d)
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    target_ = std::move(d);
+  }
+
+  mutable std::mutex mtx_;
+  delegate<Route> target_{Router{1, 0, {}}};
+};
+
+static void BM_locked_delegate_call(benchmark::State& state)
+{
+  static LockedDelegate route;
+  run_readers(state, route,
+    [](Router r) { route.store(r); });
+}
+
+BENCHMARK(BM_atomic_delegate_call)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_locked_delegate_call)->ThreadRange(1, 32)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+// Build with -std=c++20
+#include "benchmark/benchmark.h"
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include "../delegate_awaitable.hpp"
+#include "alloc_counter.hpp"
+
+// A 10 step request handler on top of a callback based I/O layer, as
+// nested callbacks and as a coroutine. The I/O layer completes one
+// operation at a time from a run loop, like a reactor would.
+
+using Completion = delegate<void(int)>;
+
+struct PendingOp
+{
+  Completion done;
+  int value;
+};
+
+static PendingOp pending;
+static bool has_pending = false;
+
+// Completes with value + 1 on the next turn of the run loop
+static void async_step(int value, Completion done)
+{
+  pending = PendingOp{std::move(done), value + 1};
+  has_pending = true;
+}
+
+static void run_loop()
+{
+  while (has_pending) {
+    has_pending = false;
+    auto op = std::move(pending);
+    op.done(op.value);
+  }
+}
+
+struct Connection
+{
+  int result = 0;
+};
+
+constexpr static const int STEPS = 10;
+
+// Each callback keeps the connection alive and remembers where it is.
+// A shared_ptr is not trivially copyable, so delegate puts the capture
+// in a heap block even though it would fit the inline buffer.
+static void callback_step(std::shared_ptr<Connection> conn, int step,
+  int value)
+{
+  async_step(value, [conn, step](int r) {
+    if (step + 1 < STEPS) callback_step(conn, step + 1, r);
+    else conn->result = r;
+  });
+}
+
+// The same with the connection kept alive by its owner instead, which
+// leaves a trivially copyable capture stored inline
+static void borrowed_callback_step(Connection* conn, int step, int value)
+{
+  async_step(value, [conn, step](int r) {
+    if (step + 1 < STEPS) borrowed_callback_step(conn, step + 1, r);
+    else conn->result = r;
+  });
+}
+
+// Fire and forget coroutine, the frame frees itself when done
+struct task
+{
+  struct promise_type
+  {
+    task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+static task coroutine_chain(std::shared_ptr<Connection> conn)
+{
+  int value = 0;
+  for (int step = 0; step < STEPS; ++step) {
+    value = co_await on_completion<int>(
+      [value](Completion done) { async_step(value, std::move(done)); });
+  }
+  conn->result = value;
+}
+
+template <typename Start>
+static void run_chain(benchmark::State& state, Start start)
+{
+  auto conn = std::make_shared<Connection>();
+  std::size_t allocs = 0;
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::allocations();
+    start(conn);
+    run_loop();
+    allocs += alloc_counter::allocations() - before;
+    benchmark::DoNotOptimize(conn->result);
+  }
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+static void BM_callback_chain(benchmark::State& state)
+{
+  run_chain(state, [](std::shared_ptr<Connection> c) {
+    callback_step(std::move(c), 0, 0);
+  });
+}
+
+static void BM_callback_chain_borrowed(benchmark::State& state)
+{
+  run_chain(state, [](std::shared_ptr<Connection> c) {
+    borrowed_callback_step(c.get(), 0, 0);
+  });
+}
+
+static void BM_coroutine_chain(benchmark::State& state)
+{
+  run_chain(state, [](std::shared_ptr<Connection> c) {
+    coroutine_chain(std::move(c));
+  });
+}
+
+BENCHMARK(BM_callback_chain);
+BENCHMARK(BM_callback_chain_borrowed);
+BENCHMARK(BM_coroutine_chain);
+
+BENCHMARK_MAIN();
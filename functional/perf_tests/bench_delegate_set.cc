@@ -0,0 +1,112 @@
+#include "benchmark/benchmark.h"
+#include <unordered_set>
+#include <vector>
+#include "../delegate_set.hpp"
+#include "alloc_counter.hpp"
+
+// A deduplicated set of handlers, bound to 100k subscriber objects
+
+struct Topic
+{
+  void on_message(int v) { sum_ += v; }
+  void on_close(int) {}
+
+  long sum_ = 0;
+};
+
+using Handler = delegate<void(int)>;
+
+constexpr static const std::size_t HANDLER_COUNT = 100000;
+
+static std::vector<Topic>& topics()
+{
+  static std::vector<Topic> t(HANDLER_COUNT);
+  return t;
+}
+
+static std::vector<Handler> make_handlers()
+{
+  std::vector<Handler> hs;
+  for (auto& t: topics()) {
+    hs.push_back(Handler::from<Topic, &Topic::on_message>(t));
+  }
+  return hs;
+}
+
+// Bound to the same objects, but to another method: never found
+static std::vector<Handler> make_misses()
+{
+  std::vector<Handler> hs;
+  for (auto& t: topics()) {
+    hs.push_back(Handler::from<Topic, &Topic::on_close>(t));
+  }
+  return hs;
+}
+
+template <typename Set>
+static void BM_handler_set_insert(benchmark::State& state)
+{
+  auto hs = make_handlers();
+  std::ptrdiff_t bytes = 0;
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::live_bytes();
+    Set s;
+    for (auto& h: hs) s.insert(h);
+    bytes = alloc_counter::live_bytes() - before;
+    benchmark::DoNotOptimize(s.size());
+  }
+  state.SetItemsProcessed(state.iterations() * hs.size());
+  state.counters["bytes/entry"] = static_cast<double>(bytes) / hs.size();
+}
+
+template <typename Set>
+static void BM_handler_set_lookup(benchmark::State& state)
+{
+  auto hs = make_handlers();
+  auto misses = make_misses();
+  Set s;
+  for (auto& h: hs) s.insert(h);
+  std::size_t found = 0;
+  while (state.KeepRunning()) {
+    for (std::size_t i = 0; i < hs.size(); ++i) {
+      found += contains(s, hs[i]);
+      found += contains(s, misses[i]);
+    }
+  }
+  benchmark::DoNotOptimize(found);
+  state.SetItemsProcessed(state.iterations() * hs.size() * 2);
+}
+
+template <typename Set>
+static void BM_handler_set_erase(benchmark::State& state)
+{
+  auto hs = make_handlers();
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    Set s;
+    for (auto& h: hs) s.insert(h);
+    state.ResumeTiming();
+    for (auto& h: hs) s.erase(h);
+    benchmark::DoNotOptimize(s.size());
+  }
+  state.SetItemsProcessed(state.iterations() * hs.size());
+}
+
+static bool contains(const std::unordered_set<Handler>& s, const Handler& h)
+{
+  return s.count(h);
+}
+
+static bool contains(const delegate_set<void(int)>& s, const Handler& h)
+{
+  return s.contains(h);
+}
+
+BENCHMARK_TEMPLATE(BM_handler_set_insert, std::unordered_set<Handler>);
+BENCHMARK_TEMPLATE(BM_handler_set_insert, delegate_set<void(int)>);
+BENCHMARK_TEMPLATE(BM_handler_set_lookup, std::unordered_set<Handler>);
+BENCHMARK_TEMPLATE(BM_handler_set_lookup, delegate_set<void(int)>);
+BENCHMARK_TEMPLATE(BM_handler_set_erase, std::unordered_set<Handler>);
+BENCHMARK_TEMPLATE(BM_handler_set_erase, delegate_set<void(int)>);
+
+BENCHMARK_MAIN();
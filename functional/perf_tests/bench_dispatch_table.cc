@@ -0,0 +1,139 @@
+#include "benchmark/benchmark.h"
+#include <array>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../impl_fast_delegate.hpp"
+
+// Opcode dispatch through a 256 entry table of handlers
+
+struct Message
+{
+  unsigned char opcode;
+  int value;
+};
+
+struct Session
+{
+  void on_data(Message& m) { bytes_ += m.value; }
+  void on_control(Message& m) { controls_ += m.opcode; }
+
+  long bytes_ = 0;
+  long controls_ = 0;
+};
+
+static Session session;
+
+static int unknown_count = 0;
+
+void on_ping(Message& m) { m.value = -m.value; }
+void on_unknown(Message&) { ++unknown_count; }
+
+constexpr static const std::size_t TABLE_SIZE = 256;
+
+template <typename Handler>
+constexpr Handler handler_for(std::size_t opcode)
+{
+  return opcode == 0 ? Handler::template from<&on_ping>() :
+    opcode < 128 ? Handler::template from<Session, &Session::on_data>(session) :
+    opcode < 192 ? Handler::template from<Session, &Session::on_control>(session) :
+    Handler::template from<&on_unknown>();
+}
+
+using StaticHandler = static_delegate<void(Message&)>;
+using Handler = delegate<void(Message&)>;
+
+template <std::size_t... I>
+constexpr std::array<StaticHandler, TABLE_SIZE>
+make_static_table(std::index_sequence<I...>)
+{
+  return {{ handler_for<StaticHandler>(I)... }};
+}
+
+// Built by the compiler, nothing runs at startup
+static constexpr auto static_table =
+  make_static_table(std::make_index_sequence<TABLE_SIZE>{});
+
+static std::array<Handler, TABLE_SIZE> make_runtime_table()
+{
+  std::array<Handler, TABLE_SIZE> t;
+  for (std::size_t i = 0; i < TABLE_SIZE; ++i) {
+    t[i] = handler_for<Handler>(i);
+  }
+  return t;
+}
+
+static std::array<std::function<void(Message&)>, TABLE_SIZE>
+make_std_function_table()
+{
+  std::array<std::function<void(Message&)>, TABLE_SIZE> t;
+  for (std::size_t i = 0; i < TABLE_SIZE; ++i) {
+    t[i] = handler_for<StaticHandler>(i);
+  }
+  return t;
+}
+
+// What a function local static table costs the first time through
+static void BM_runtime_table_build(benchmark::State& state)
+{
+  while (state.KeepRunning()) {
+    auto t = make_runtime_table();
+    benchmark::DoNotOptimize(t.data());
+  }
+}
+
+static void BM_std_function_table_build(benchmark::State& state)
+{
+  while (state.KeepRunning()) {
+    auto t = make_std_function_table();
+    benchmark::DoNotOptimize(t.data());
+  }
+}
+
+static std::vector<Message> make_messages()
+{
+  std::mt19937 rng(42);
+  std::vector<Message> msgs(4096);
+  for (auto& m: msgs) {
+    m.opcode = static_cast<unsigned char>(rng());
+    m.value = static_cast<int>(rng() & 0xff);
+  }
+  return msgs;
+}
+
+template <typename Table>
+static void run_dispatch(benchmark::State& state, const Table& table)
+{
+  auto msgs = make_messages();
+  while (state.KeepRunning()) {
+    for (auto& m: msgs) table[m.opcode](m);
+  }
+  benchmark::DoNotOptimize(session);
+  state.SetItemsProcessed(state.iterations() * msgs.size());
+}
+
+static void BM_static_table_dispatch(benchmark::State& state)
+{
+  run_dispatch(state, static_table);
+}
+
+static void BM_runtime_table_dispatch(benchmark::State& state)
+{
+  static const auto table = make_runtime_table();
+  run_dispatch(state, table);
+}
+
+static void BM_std_function_table_dispatch(benchmark::State& state)
+{
+  static const auto table = make_std_function_table();
+  run_dispatch(state, table);
+}
+
+BENCHMARK(BM_runtime_table_build);
+BENCHMARK(BM_std_function_table_build);
+BENCHMARK(BM_static_table_dispatch);
+BENCHMARK(BM_runtime_table_dispatch);
+BENCHMARK(BM_std_function_table_dispatch);
+
+BENCHMARK_MAIN();
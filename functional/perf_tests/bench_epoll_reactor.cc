@@ -0,0 +1,179 @@
+// Linux only
+#include "benchmark/benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../epoll_reactor.hpp"
+
+// Local traffic through epoll_reactor: each iteration writes a
+// timestamp to 256 distinct connections (all of them when there are
+// fewer), then runs the reactor until every handler has read its
+// message. The connections are eventfds (Arg 0) or AF_UNIX socketpairs
+// (Arg 1), all registered edge triggered.
+//
+// Latency is from write to read in the handler, so it includes the
+// rest of the batch being written and dispatched ahead of it.
+//
+// 100k connections need 100k (eventfd) or 200k (socketpair) fds. The
+// soft RLIMIT_NOFILE is raised to the hard one, and what does not fit
+// is skipped with an error.
+
+static std::int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps a uniform sample of at most CAPACITY latencies
+struct Latencies
+{
+  constexpr static const std::size_t CAPACITY = 1 << 20;
+
+  void record(std::int64_t ns)
+  {
+    ++count;
+    if (samples.size() < CAPACITY) {
+      samples.push_back(ns);
+    } else {
+      auto i = std::uniform_int_distribution<std::size_t>(0, count - 1)(rng);
+      if (i < CAPACITY) samples[i] = ns;
+    }
+  }
+
+  double percentile(double p)
+  {
+    if (samples.empty()) return 0;
+    auto nth = samples.begin() +
+      static_cast<std::ptrdiff_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), nth, samples.end());
+    return static_cast<double>(*nth);
+  }
+
+  std::vector<std::int64_t> samples;
+  std::size_t count = 0;
+  std::mt19937_64 rng{42};
+};
+
+struct Connection
+{
+  // Edge triggered: read until EAGAIN
+  void on_ready(int fd, std::uint32_t)
+  {
+    std::uint64_t stamp;
+    while (read(fd, &stamp, sizeof(stamp)) == sizeof(stamp)) {
+      latencies->record(now_ns() - static_cast<std::int64_t>(stamp));
+    }
+  }
+
+  int read_fd = -1;
+  int write_fd = -1;
+  Latencies* latencies = nullptr;
+};
+
+static bool open_connection(Connection& c, bool socket)
+{
+  if (socket) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv)) {
+      return false;
+    }
+    c.read_fd = sv[0];
+    c.write_fd = sv[1];
+  } else {
+    c.read_fd = c.write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  }
+  return c.read_fd != -1;
+}
+
+static void close_connection(Connection& c)
+{
+  if (c.write_fd != c.read_fd) close(c.write_fd);
+  if (c.read_fd != -1) close(c.read_fd);
+}
+
+static rlim_t raise_fd_limit()
+{
+  rlimit lim;
+  if (getrlimit(RLIMIT_NOFILE, &lim)) return 0;
+  if (lim.rlim_cur < lim.rlim_max) {
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+    getrlimit(RLIMIT_NOFILE, &lim);
+  }
+  return lim.rlim_cur;
+}
+
+constexpr static const std::size_t BATCH_SIZE = 256;
+
+static void BM_epoll_reactor(benchmark::State& state)
+{
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const bool socket = state.range(1) != 0;
+
+  static const rlim_t fd_limit = raise_fd_limit();
+  if (n * (socket ? 2 : 1) + 64 > fd_limit) {
+    state.SkipWithError("not enough file descriptors");
+    return;
+  }
+
+  Latencies latencies;
+  std::vector<Connection> conns(n);
+  epoll_reactor reactor(BATCH_SIZE);
+
+  for (auto& c : conns) {
+    if (!open_connection(c, socket)) {
+      state.SkipWithError("cannot open connection");
+      break;
+    }
+    c.latencies = &latencies;
+    reactor.add(c.read_fd, EPOLLIN | EPOLLET,
+      epoll_reactor::handler_type::from<Connection, &Connection::on_ready>(c));
+  }
+
+  const std::size_t batch = std::min(n, BATCH_SIZE);
+  std::mt19937 rng(42);
+
+  while (state.KeepRunning()) {
+    const std::size_t first = rng() % n;
+    std::size_t written = 0;
+    for (; written < batch; ++written) {
+      auto stamp = static_cast<std::uint64_t>(now_ns());
+      auto fd = conns[(first + written) % n].write_fd;
+      if (write(fd, &stamp, sizeof(stamp)) != sizeof(stamp)) {
+        state.SkipWithError("write failed");
+        break;
+      }
+    }
+
+    const std::size_t target = latencies.count + written;
+    while (latencies.count < target) {
+      reactor.run_once();
+    }
+  }
+
+  for (auto& c : conns) close_connection(c);
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(latencies.count));
+  state.counters["p50_ns"] = latencies.percentile(0.50);
+  state.counters["p99_ns"] = latencies.percentile(0.99);
+}
+
+static void connection_counts(benchmark::internal::Benchmark* b)
+{
+  for (int socket : {0, 1}) {
+    for (int n : {10, 100, 1000, 10000, 100000}) {
+      b->Args({n, socket});
+    }
+  }
+}
+
+BENCHMARK(BM_epoll_reactor)->Apply(connection_counts)
+  ->ArgNames({"connections", "socketpair"})->UseRealTime();
+
+BENCHMARK_MAIN();
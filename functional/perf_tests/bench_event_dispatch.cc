@@ -0,0 +1,139 @@
+#include "benchmark/benchmark.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../batched_dispatcher.hpp"
+#include "perf_counter.hpp"
+
+// The EventHandler model of perf_vf.cc: 1M ready events, each calling
+// a DataHandler or an AcceptHandler through the base class, compared
+// with the same events grouped by handler type.
+//
+// Arg 0 alternates the two types like perf_vf.cc, Arg 1 mixes them at
+// random, which is what a reactor gets from a busy poll set.
+
+class EventHandler
+{
+public:
+  virtual void handle_event(void* user_ctx) = 0;
+  virtual ~EventHandler() = default;
+};
+
+class AcceptHandler final: public EventHandler
+{
+public:
+  AcceptHandler() {}
+  void handle_event(void* uctx)
+  {
+    (void) uctx;
+  }
+
+private:
+  int fd_ = -1;
+};
+
+struct Ctx { volatile int di; };
+
+class DataHandler final: public EventHandler
+{
+public:
+  DataHandler(int fd): fd_(fd) {}
+  void handle_event(void* uctx)
+  {
+    auto ctx_ptr = static_cast<Ctx*>(uctx);
+    ctx_ptr->di++;
+  }
+private:
+  int fd_ = -1;
+};
+
+enum EventTypes: uint8_t
+{
+  AcceptEventType = 0,
+  DataEventType,
+};
+
+using Dispatcher = batched_dispatcher<EventTypes, EventHandler,
+  AcceptHandler, DataHandler>;
+
+constexpr static const int EVENT_COUNT = 1000000;
+
+using ReadyEvent = std::pair<EventTypes, EventHandler*>;
+
+struct Handlers
+{
+  std::vector<std::unique_ptr<EventHandler>> owned;
+  std::vector<ReadyEvent> ready;
+};
+
+static Handlers make_handlers(bool shuffled)
+{
+  Handlers h;
+  h.owned.reserve(EVENT_COUNT);
+  h.ready.reserve(EVENT_COUNT);
+
+  std::mt19937 rng(42);
+  for (int i = 0; i < EVENT_COUNT; ++i) {
+    bool data = shuffled ? (rng() & 1) : i % 2 == 0;
+    if (data) {
+      h.owned.emplace_back(std::make_unique<DataHandler>(i));
+      h.ready.emplace_back(DataEventType, h.owned.back().get());
+    } else {
+      h.owned.emplace_back(std::make_unique<AcceptHandler>());
+      h.ready.emplace_back(AcceptEventType, h.owned.back().get());
+    }
+  }
+  return h;
+}
+
+template <typename Run>
+static void run_events(benchmark::State& state, Run run)
+{
+  auto h = make_handlers(state.range(0) != 0);
+  Ctx ctx{0};
+
+  perf_counter misses(perf_counter::event::branch_misses);
+  misses.start();
+  while (state.KeepRunning()) {
+    run(h.ready, ctx);
+  }
+  misses.stop();
+
+  const double events = static_cast<double>(h.ready.size());
+  state.counters["time/event"] = benchmark::Counter(
+      events, benchmark::Counter::kIsIterationInvariantRate |
+      benchmark::Counter::kInvert);
+  if (misses.valid()) {
+    state.counters["branch_misses/event"] = benchmark::Counter(
+        misses.value() / events, benchmark::Counter::kAvgIterations);
+  }
+}
+
+static void BM_interleaved_virtual(benchmark::State& state)
+{
+  run_events(state, [](std::vector<ReadyEvent>& ready, Ctx& ctx) {
+    for (auto& ev : ready) {
+      ev.second->handle_event(&ctx);
+    }
+  });
+}
+
+static void BM_type_batched(benchmark::State& state)
+{
+  Dispatcher d;
+  d.reserve(EVENT_COUNT);
+  run_events(state, [&d](std::vector<ReadyEvent>& ready, Ctx& ctx) {
+    for (auto& ev : ready) {
+      d.post(ev.first, *ev.second);
+    }
+    d.dispatch(static_cast<void*>(&ctx));
+  });
+}
+
+BENCHMARK(BM_interleaved_virtual)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_type_batched)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -7,10 +7,63 @@
 #include <cstring>
 #include <vector>
 #include <memory>
+#include <random>
+#include <tuple>
 #include "../impl_fast_delegate.hpp"
+#include "../fast_func.hpp"
+#include "../devirt_call.hpp"
+#include "../my_function.hpp"
+#include "alloc_counter.hpp"
+#include "perf_counter.hpp"
+
+#if __cplusplus >= 201703L
+# include <memory_resource>
+#endif
 
 constexpr static const int ITER_COUNT = 1000000;
 
+// Hardware counters around a benchmark's timed loop, reported per
+// iteration: cycles, instructions, IPC, branch misses and L1 icache
+// and dcache read misses. Where perf_event_open is not available, as
+// in most containers, only the times are reported.
+class HwCounters
+{
+public:
+  explicit HwCounters(benchmark::State& state) : state_(state)
+  {
+    group_.start();
+  }
+
+  ~HwCounters()
+  {
+    group_.stop();
+    auto values = group_.values();
+    if (values.empty()) return;
+
+    static const char* const names[] = {
+      "cycles", "instructions", "branch_misses", "l1i_misses", "l1d_misses"
+    };
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (!group_.valid(i)) continue;
+      state_.counters[names[i]] = benchmark::Counter(
+          static_cast<double>(values[i]), benchmark::Counter::kAvgIterations);
+    }
+    if (group_.valid(0) && group_.valid(1) && values[0]) {
+      state_.counters["IPC"] = static_cast<double>(values[1]) / values[0];
+    }
+  }
+
+private:
+  benchmark::State& state_;
+  perf_counter_group group_{
+    perf_counter::event::cycles,
+    perf_counter::event::instructions,
+    perf_counter::event::branch_misses,
+    perf_counter::event::l1i_misses,
+    perf_counter::event::l1d_misses,
+  };
+};
+
 // This test i.e polymorphic callback is modelled after the test
 // presented in http://www.codeproject.com/Articles/616090/Delegates-Cplusplus-vs-Impossibly-Fast-A-Quick-a
 //
@@ -65,6 +118,31 @@ private:
   Handler h_;
 };
 
+class MF_Button : public Object
+{
+public:
+  using Handler = Function<void(Object*)>;
+
+  void setCallback(const Handler& h)
+  {
+    h_ = h;
+  }
+
+  template <typename Callable>
+  void setCallback(Callable&& cb)
+  {
+    h_ = std::forward<Callable>(cb);
+  }
+
+  void doCallback()
+  {
+    (void) h_(this);
+  }
+
+private:
+  Handler h_;
+};
+
 /////////////////////////
 //  std::function
 /////////////////////////
@@ -79,6 +157,7 @@ static void BM_std_function_basic(benchmark::State& state)
   std::function<volatile int(volatile int)> f(fun_function);
   volatile int v = 0;
 
+  HwCounters hw(state);
   while (state.KeepRunning()) {
     v = f(v);
   }
@@ -106,6 +185,7 @@ auto run_handler(Handler&& handler, Args&&... args)
 
 static void BM_std_function_heavy(benchmark::State& state)
 {
+  HwCounters hw(state);
   while (state.KeepRunning()) {
     std::function<bool (const char*)> dhandler{BigFunctor()};
     benchmark::DoNotOptimize(
@@ -119,8 +199,9 @@ BENCHMARK(BM_std_function_heavy);
 static void BM_std_function_poly_cb(benchmark::State& state)
 {
   SF_Button butt;
+  HwCounters hw(state);
   while (state.KeepRunning()) {
-    butt.setCallback([&butt](auto ptr) mutable { 
+    butt.setCallback([&butt](Object*) mutable { 
         butt.count_ = fun_function(butt.count_); });
   }
 }
@@ -163,6 +244,7 @@ static void BM_virtual_function_basic(benchmark::State& state)
   }
   volatile int v = 0;
 
+  HwCounters hw(state);
   while (state.KeepRunning()) {
     v = b->fun_function(v);
   }
@@ -170,6 +252,72 @@ static void BM_virtual_function_basic(benchmark::State& state)
 
 BENCHMARK(BM_virtual_function_basic)->Arg('0');
 
+// Receivers of a call site through Base*: Arg 1 all Derived, Arg 2
+// Derived and Decrement, Arg 4 also two types not among the devirt_call
+// candidates. Shuffled so that the types do not follow a pattern.
+// Dummy is left out as its override is the same as Derived's, and
+// the linker may fold the two into one target.
+class Decrement final : public Base {
+public:
+  volatile int fun_function(volatile int i) {
+    return --i;
+  }
+};
+
+template <int N>
+class Other final : public Base {
+public:
+  volatile int fun_function(volatile int i) {
+    return i + N;
+  }
+};
+
+static std::vector<Base*> make_receivers(int types)
+{
+  static Derived d;
+  static Decrement m;
+  static Other<1> o1;
+  static Other<2> o2;
+  Base* const all[] = {&d, &m, &o1, &o2};
+
+  std::vector<Base*> receivers(1 << 16);
+  for (std::size_t i = 0; i < receivers.size(); ++i) {
+    receivers[i] = all[i % types];
+  }
+  std::shuffle(receivers.begin(), receivers.end(), std::mt19937(42));
+  return receivers;
+}
+
+static void BM_virtual_function_receivers(benchmark::State& state)
+{
+  auto receivers = make_receivers(static_cast<int>(state.range(0)));
+  volatile int v = 0;
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    for (auto b : receivers) v = b->fun_function(v);
+  }
+  state.SetItemsProcessed(state.iterations() * receivers.size());
+}
+
+static void BM_devirt_call_receivers(benchmark::State& state)
+{
+  auto receivers = make_receivers(static_cast<int>(state.range(0)));
+  volatile int v = 0;
+  auto const call = [](auto& o, volatile int i) { return o.fun_function(i); };
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    for (auto b : receivers) {
+      v = devirt_call<Derived, Decrement>(b, call, v);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * receivers.size());
+}
+
+BENCHMARK(BM_virtual_function_receivers)->Arg(1)->Arg(2)->Arg(4);
+BENCHMARK(BM_devirt_call_receivers)->Arg(1)->Arg(2)->Arg(4);
+
 
 /////////////////////////////
 // Impossibly fast delegate
@@ -179,6 +327,7 @@ static void BM_imp_fast_delegate_basic(benchmark::State& state)
 {
   delegate<volatile int (volatile int)> del(fun_function);
   volatile int v = 0;
+  HwCounters hw(state);
   while (state.KeepRunning()) {
     v = del(v);
   }
@@ -188,6 +337,7 @@ BENCHMARK(BM_imp_fast_delegate_basic);
 
 static void BM_imp_fast_delegate_heavy(benchmark::State& state)
 {
+  HwCounters hw(state);
   while (state.KeepRunning()) {
     delegate<bool(const char*)> dhandler{BigFunctor()};
     benchmark::DoNotOptimize(
@@ -201,12 +351,590 @@ BENCHMARK(BM_imp_fast_delegate_heavy);
 static void BM_imp_fast_delegate_poly_cb(benchmark::State& state)
 {
   FD_Button butt;
+  HwCounters hw(state);
   while (state.KeepRunning()) {
-    butt.setCallback([&butt](auto ptr) mutable {
+    butt.setCallback([&butt](Object*) mutable {
           butt.count_ = fun_function(butt.count_); });
   }
 }
 
 BENCHMARK(BM_imp_fast_delegate_poly_cb);
 
+/////////////////////////////
+// FastFunc
+/////////////////////////////
+
+static void BM_fast_func_basic(benchmark::State& state)
+{
+  ssvu::FastFunc<volatile int (volatile int)> f(fun_function);
+  volatile int v = 0;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    v = f(v);
+  }
+}
+
+BENCHMARK(BM_fast_func_basic);
+
+// Construct, copy and call; a captureless lambda becomes a function
+// pointer and a small trivially copyable capture is stored inline
+template <typename Make>
+static void run_fast_func_lambda(benchmark::State& state, Make make)
+{
+  volatile int v = 0;
+  std::size_t allocs = 0;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::allocations();
+    ssvu::FastFunc<volatile int (volatile int)> f{make()};
+    auto copy = f;
+    v = copy(v);
+    allocs += alloc_counter::allocations() - before;
+  }
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+static void BM_fast_func_stateless_lambda(benchmark::State& state)
+{
+  run_fast_func_lambda(state, [] {
+    return [](volatile int v) -> volatile int { return v + 1; };
+  });
+}
+
+BENCHMARK(BM_fast_func_stateless_lambda);
+
+static void BM_fast_func_small_capture(benchmark::State& state)
+{
+  Object obj;
+  run_fast_func_lambda(state, [&obj] {
+    return [&obj](volatile int v) -> volatile int { return v + obj.count_; };
+  });
+}
+
+BENCHMARK(BM_fast_func_small_capture);
+
+static void BM_fast_func_heavy(benchmark::State& state)
+{
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    ssvu::FastFunc<bool(const char*)> dhandler{BigFunctor()};
+    benchmark::DoNotOptimize(
+      run_handler(std::move(dhandler), "SampleString")
+    );
+  }
+}
+
+BENCHMARK(BM_fast_func_heavy);
+
+/////////////////////////////
+// my Function
+/////////////////////////////
+
+static void BM_my_function_basic(benchmark::State& state)
+{
+  Function<volatile int (volatile int)> f(fun_function);
+  volatile int v = 0;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    v = f(v);
+  }
+}
+
+BENCHMARK(BM_my_function_basic);
+
+static void BM_my_function_heavy(benchmark::State& state)
+{
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    Function<bool(const char*)> dhandler{BigFunctor()};
+    benchmark::DoNotOptimize(
+      run_handler(std::move(dhandler), "SampleString")
+    );
+  }
+}
+
+BENCHMARK(BM_my_function_heavy);
+
+// Same as above, with an explicitly sized 64 byte inline buffer
+static void BM_my_function_heavy_inline(benchmark::State& state)
+{
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    Function<bool(const char*), 64> dhandler{BigFunctor()};
+    benchmark::DoNotOptimize(
+      run_handler(std::move(dhandler), "SampleString")
+    );
+  }
+}
+
+BENCHMARK(BM_my_function_heavy_inline);
+
+static void BM_my_function_poly_cb(benchmark::State& state)
+{
+  MF_Button butt;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    butt.setCallback([&butt](Object*) mutable {
+          butt.count_ = fun_function(butt.count_); });
+  }
+}
+
+BENCHMARK(BM_my_function_poly_cb);
+
+// The callback is too big for the inline buffer, but as its type
+// does not change the heap block is reused.
+static void BM_my_function_poly_cb_heavy(benchmark::State& state)
+{
+  MF_Button butt;
+  std::size_t allocs = 0;
+  char pad[64] = {};
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::allocations();
+    butt.setCallback([&butt, pad](Object*) mutable {
+          butt.count_ = fun_function(butt.count_ + pad[0]); });
+    allocs += alloc_counter::allocations() - before;
+  }
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_my_function_poly_cb_heavy);
+
+/////////////////////////////
+// Construct + call across functor sizes
+/////////////////////////////
+
+template <std::size_t N>
+struct SizedFunctor
+{
+  volatile int operator()(volatile int v) { return v + buf_[N - 1]; }
+  char buf_[N] = {};
+};
+
+template <typename Handler, std::size_t N>
+static void BM_sized_functor(benchmark::State& state)
+{
+  volatile int v = 0;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    Handler h{SizedFunctor<N>()};
+    v = h(v);
+    benchmark::DoNotOptimize(v);
+  }
+}
+
+template <std::size_t N>
+static void BM_std_function_sized(benchmark::State& state)
+{
+  BM_sized_functor<std::function<volatile int(volatile int)>, N>(state);
+}
+
+template <std::size_t N>
+static void BM_imp_fast_delegate_sized(benchmark::State& state)
+{
+  BM_sized_functor<delegate<volatile int(volatile int)>, N>(state);
+}
+
+template <std::size_t N>
+static void BM_my_function_sized(benchmark::State& state)
+{
+  BM_sized_functor<Function<volatile int(volatile int)>, N>(state);
+}
+
+template <std::size_t N>
+static void BM_my_function_sized_inline64(benchmark::State& state)
+{
+  BM_sized_functor<Function<volatile int(volatile int), 64>, N>(state);
+}
+
+template <std::size_t N>
+static void BM_fast_func_sized(benchmark::State& state)
+{
+  BM_sized_functor<ssvu::FastFunc<volatile int(volatile int)>, N>(state);
+}
+
+#define BENCHMARK_SIZED(bm) \
+  BENCHMARK_TEMPLATE(bm, 8); BENCHMARK_TEMPLATE(bm, 16); \
+  BENCHMARK_TEMPLATE(bm, 32); BENCHMARK_TEMPLATE(bm, 48); \
+  BENCHMARK_TEMPLATE(bm, 128)
+
+BENCHMARK_SIZED(BM_std_function_sized);
+BENCHMARK_SIZED(BM_imp_fast_delegate_sized);
+BENCHMARK_SIZED(BM_my_function_sized);
+BENCHMARK_SIZED(BM_my_function_sized_inline64);
+BENCHMARK_SIZED(BM_fast_func_sized);
+
+// delegate with an inline buffer as large as the capture: construct,
+// copy and call without touching the heap
+template <std::size_t N>
+static void BM_imp_fast_delegate_inline(benchmark::State& state)
+{
+  using Handler = delegate<volatile int(volatile int), N>;
+  volatile int v = 0;
+  std::size_t allocs = 0;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::allocations();
+    Handler h{SizedFunctor<N>()};
+    Handler copy{h};
+    v = copy(v);
+    allocs += alloc_counter::allocations() - before;
+  }
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_inline, 16);
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_inline, 32);
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_inline, 64);
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_inline, 128);
+
+// Copies and destroys a delegate holding a heap stored functor, under
+// each ownership policy
+template <typename Ownership>
+static void BM_imp_fast_delegate_copy(benchmark::State& state)
+{
+  using Handler = delegate<volatile int(volatile int), 32, Ownership>;
+  const Handler h{SizedFunctor<64>()};
+  std::vector<Handler> copies;
+  copies.reserve(1024);
+  volatile int v = 0;
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    for (int i = 0; i < 1024; ++i) copies.push_back(h);
+    v = copies.back()(v);
+    copies.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_copy, shared_store);
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_copy, local_store);
+BENCHMARK_TEMPLATE(BM_imp_fast_delegate_copy, deep_copy_store);
+
+/////////////////////////////
+// Growing a vector of handlers
+/////////////////////////////
+
+// Fits the inline buffer of Function (not that of std::function) and
+// allocates whenever it is copied, but not when it is moved
+struct OwningFunctor
+{
+  OwningFunctor() : p_(new int(1)) {}
+  OwningFunctor(const OwningFunctor& other) : p_(new int(*other.p_)) {}
+  OwningFunctor(OwningFunctor&& other) noexcept : p_(other.p_)
+  {
+    other.p_ = nullptr;
+  }
+  OwningFunctor& operator=(const OwningFunctor&) = delete;
+  ~OwningFunctor() { delete p_; }
+
+  volatile int operator()(volatile int v) { return v + *p_; }
+
+  int* p_;
+};
+
+// Function whose move may throw, so that a growing vector copies it
+struct CopyOnGrowFunction : Function<volatile int(volatile int)>
+{
+  using Function::Function;
+  CopyOnGrowFunction(const CopyOnGrowFunction&) = default;
+  CopyOnGrowFunction(CopyOnGrowFunction&& other) noexcept(false) :
+    Function(std::move(other)) {}
+};
+
+template <typename Handler>
+static std::size_t fill_handlers(std::size_t n, bool reserve)
+{
+  std::vector<Handler> handlers;
+  auto before = alloc_counter::allocations();
+  if (reserve) handlers.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    handlers.emplace_back(OwningFunctor());
+  }
+  benchmark::DoNotOptimize(handlers.data());
+  return alloc_counter::allocations() - before;
+}
+
+// Pushes handlers into a vector that is not reserved. Every
+// reallocation clones the elements, and their targets, unless the
+// handler has a noexcept move. growth_allocs/elem counts only what
+// growing adds over filling a reserved vector, which is one buffer
+// per reallocation plus the clones.
+template <typename Handler>
+static void BM_vector_growth(benchmark::State& state)
+{
+  const auto n = static_cast<std::size_t>(state.range(0));
+  // Target allocations only, without the reserved buffer
+  const auto reserved = fill_handlers<Handler>(n, true) - 1;
+  std::size_t allocs = 0;
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    allocs += fill_handlers<Handler>(n, false) - reserved;
+  }
+  state.counters["growth_allocs/elem"] = benchmark::Counter(
+      static_cast<double>(allocs) / n, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(BM_vector_growth,
+    std::function<volatile int(volatile int)>)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_vector_growth,
+    Function<volatile int(volatile int)>)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_vector_growth,
+    UniqueFunction<volatile int(volatile int)>)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_vector_growth, CopyOnGrowFunction)->Arg(1024);
+
+/////////////////////////////
+// Member function pointer on a large object
+/////////////////////////////
+
+struct BigModel
+{
+  BigModel() = default;
+  BigModel(const BigModel& other)
+  {
+    ++copies;
+    memcpy(data_, other.data_, sizeof(data_));
+  }
+
+  volatile int value(volatile int i) const { return data_[i & 1023] + i; }
+
+  static std::size_t copies;
+  int data_[1024] = {}; // 4 KB
+};
+
+std::size_t BigModel::copies = 0;
+
+// ObjectArg is how the object is handed to the Function
+template <typename ObjectArg, typename Object>
+static void BM_my_function_member_4k(benchmark::State& state, Object&& obj)
+{
+  Function<volatile int(ObjectArg, volatile int)> f(&BigModel::value);
+  volatile int v = 0;
+  auto before = BigModel::copies;
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    v = f(obj, v);
+  }
+  state.counters["copies"] = static_cast<double>(BigModel::copies - before);
+}
+
+static void BM_my_function_member_4k_ref(benchmark::State& state)
+{
+  BigModel m;
+  BM_my_function_member_4k<const BigModel&>(state, m);
+}
+
+static void BM_my_function_member_4k_ptr(benchmark::State& state)
+{
+  BigModel m;
+  BM_my_function_member_4k<BigModel*>(state, &m);
+}
+
+static void BM_my_function_member_4k_ref_wrapper(benchmark::State& state)
+{
+  BigModel m;
+  BM_my_function_member_4k<std::reference_wrapper<BigModel>>(state, std::ref(m));
+}
+
+static void BM_my_function_member_4k_unique_ptr(benchmark::State& state)
+{
+  auto m = std::make_unique<BigModel>();
+  BM_my_function_member_4k<const std::unique_ptr<BigModel>&>(state, m);
+}
+
+static void BM_my_function_member_4k_shared_ptr(benchmark::State& state)
+{
+  auto m = std::make_shared<BigModel>();
+  BM_my_function_member_4k<const std::shared_ptr<BigModel>&>(state, m);
+}
+
+BENCHMARK(BM_my_function_member_4k_ref);
+BENCHMARK(BM_my_function_member_4k_ptr);
+BENCHMARK(BM_my_function_member_4k_ref_wrapper);
+BENCHMARK(BM_my_function_member_4k_unique_ptr);
+BENCHMARK(BM_my_function_member_4k_shared_ptr);
+
+/////////////////////////////
+// Copying a handler table
+/////////////////////////////
+
+// Configuration reload: copy a table of 100k handlers whose targets
+// are function pointers or lambdas capturing an int and a pointer.
+template <typename Handler>
+static void BM_copy_handler_table(benchmark::State& state)
+{
+  static volatile int counter = 0;
+  std::vector<Handler> table;
+  table.reserve(100000);
+  for (int i = 0; i < 100000; ++i) {
+    if (i % 2) table.emplace_back(fun_function);
+    else table.emplace_back([i, p = &counter](volatile int v) { return v + i + *p; });
+  }
+
+  // Keeps its capacity, so only the element copies are measured
+  std::vector<Handler> copy;
+  copy.reserve(table.size());
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    copy.clear();
+    copy.insert(copy.end(), table.begin(), table.end());
+    benchmark::DoNotOptimize(copy.data());
+  }
+  state.SetItemsProcessed(state.iterations() * table.size());
+}
+
+BENCHMARK_TEMPLATE(BM_copy_handler_table,
+    std::function<volatile int(volatile int)>);
+BENCHMARK_TEMPLATE(BM_copy_handler_table,
+    Function<volatile int(volatile int)>);
+
+/////////////////////////////
+// Batch invocation
+/////////////////////////////
+
+// fun_function without the volatile, so the compiler may vectorize
+int fun_plain(int v)
+{
+  return v + 1;
+}
+
+constexpr static const int BATCH_SIZE = 1 << 16;
+
+static std::vector<std::tuple<int>> batch_args()
+{
+  std::vector<std::tuple<int>> args;
+  for (int i = 0; i < BATCH_SIZE; ++i) args.emplace_back(i);
+  return args;
+}
+
+template <typename Handler>
+static void run_per_element(benchmark::State& state, Handler& h)
+{
+  auto args = batch_args();
+  std::vector<int> results(args.size());
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    for (std::size_t i = 0; i < args.size(); ++i) {
+      results[i] = h(std::get<0>(args[i]));
+    }
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * args.size());
+}
+
+template <typename Handler>
+static void run_batch(benchmark::State& state, Handler& h)
+{
+  auto args = batch_args();
+  std::vector<int> results(args.size());
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    h.invoke_batch(args.data(), args.size(), results.data());
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * args.size());
+}
+
+static void BM_my_function_per_element(benchmark::State& state)
+{
+  Function<int(int)> f([](int v) { return fun_plain(v); });
+  run_per_element(state, f);
+}
+
+static void BM_my_function_batch(benchmark::State& state)
+{
+  Function<int(int)> f([](int v) { return fun_plain(v); });
+  run_batch(state, f);
+}
+
+static void BM_imp_fast_delegate_per_element(benchmark::State& state)
+{
+  auto d = delegate<int(int)>::from<&fun_plain>();
+  run_per_element(state, d);
+}
+
+static void BM_imp_fast_delegate_batch(benchmark::State& state)
+{
+  auto d = delegate<int(int)>::from<&fun_plain>();
+  run_batch(state, d);
+}
+
+BENCHMARK(BM_my_function_per_element);
+BENCHMARK(BM_my_function_batch);
+BENCHMARK(BM_imp_fast_delegate_per_element);
+BENCHMARK(BM_imp_fast_delegate_batch);
+
+/////////////////////////////
+// Request scoped arena
+/////////////////////////////
+
+// Builds (and copies) a batch of handlers too big for the inline
+// buffer, the way a request would, then drops all of them.
+template <typename Handlers, typename... AllocArg>
+static void build_request_handlers(Handlers& handlers,
+                                   const AllocArg&... alloc_arg)
+{
+  handlers.reserve(64);
+  for (int i = 0; i < 32; ++i) {
+    handlers.emplace_back(alloc_arg..., SizedFunctor<64>());
+    handlers.emplace_back(handlers.back());
+  }
+  volatile int v = 0;
+  for (auto& h : handlers) v = h(v);
+  benchmark::DoNotOptimize(v);
+}
+
+static void BM_my_function_request_heap(benchmark::State& state)
+{
+  using Handler = Function<volatile int(volatile int)>;
+  std::size_t allocs = 0;
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::allocations();
+    {
+      std::vector<Handler> handlers;
+      build_request_handlers(handlers);
+    }
+    allocs += alloc_counter::allocations() - before;
+  }
+  state.counters["global_news"] = benchmark::Counter(
+      static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_my_function_request_heap);
+
+#if __cplusplus >= 201703L
+static void BM_my_function_request_arena(benchmark::State& state)
+{
+  using Handler = Function<volatile int(volatile int)>;
+  alignas(std::max_align_t) static char arena[64 * 1024];
+  std::size_t allocs = 0;
+
+  HwCounters hw(state);
+  while (state.KeepRunning()) {
+    auto before = alloc_counter::allocations();
+    {
+      std::pmr::monotonic_buffer_resource mr(arena, sizeof(arena),
+          std::pmr::null_memory_resource());
+      // The vector comes from the arena too
+      std::pmr::vector<Handler> handlers(&mr);
+      build_request_handlers(handlers, std::allocator_arg,
+          std::pmr::polymorphic_allocator<char>(&mr));
+    }
+    allocs += alloc_counter::allocations() - before;
+  }
+  state.counters["global_news"] = benchmark::Counter(
+      static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_my_function_request_arena);
+#endif
+
 BENCHMARK_MAIN();
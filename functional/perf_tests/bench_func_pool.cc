@@ -0,0 +1,84 @@
+#include "benchmark/benchmark.h"
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+#include "../my_function.hpp"
+#include "../func_pool.hpp"
+
+// Construct / call / destroy handler churn, the BM_std_function_heavy
+// pattern, on 1 to 16 threads. The handler is too big for the inline
+// buffer so every construction goes to the allocator.
+
+struct HeavyFunctor
+{
+  bool operator()(const char* s) {
+    auto siz = strlen(s);
+    memcpy((void*)buf_, s, siz);
+    return siz%2 ? true : false;
+  }
+
+  char buf_[64];
+};
+
+using Handler = Function<bool(const char*)>;
+
+static double rss_mb()
+{
+  long pages = 0, resident = 0;
+  std::ifstream statm("/proc/self/statm");
+  statm >> pages >> resident;
+  return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+template <typename... AllocArg>
+static void run_churn(benchmark::State& state, const AllocArg&... alloc_arg)
+{
+  while (state.KeepRunning()) {
+    Handler h(alloc_arg..., HeavyFunctor());
+    benchmark::DoNotOptimize(h("SampleString"));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) state.counters["rss_MB"] = rss_mb();
+}
+
+static void BM_handler_churn_heap(benchmark::State& state)
+{
+  run_churn(state);
+}
+
+static void BM_handler_churn_pool(benchmark::State& state)
+{
+  run_churn(state, std::allocator_arg, pool_allocator<char>());
+}
+
+BENCHMARK(BM_handler_churn_heap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_handler_churn_pool)->ThreadRange(1, 16)->UseRealTime();
+
+// Handlers outliving the iteration: a window of live handlers with
+// the oldest one being destroyed for every new one.
+template <typename... AllocArg>
+static void run_window(benchmark::State& state, const AllocArg&... alloc_arg)
+{
+  std::vector<Handler> window(256);
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    window[i++ % window.size()] = Handler(alloc_arg..., HeavyFunctor());
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) state.counters["rss_MB"] = rss_mb();
+}
+
+static void BM_handler_window_heap(benchmark::State& state)
+{
+  run_window(state);
+}
+
+static void BM_handler_window_pool(benchmark::State& state)
+{
+  run_window(state, std::allocator_arg, pool_allocator<char>());
+}
+
+BENCHMARK(BM_handler_window_heap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_handler_window_pool)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,80 @@
+#include "benchmark/benchmark.h"
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+#include "../function_ref.hpp"
+#include "../impl_fast_delegate.hpp"
+#include "../my_function.hpp"
+
+// Sorting 1M elements with a stateful comparator handed over
+// through the different callable wrappers. The wrapper is only used
+// for the duration of the call, which is what function_ref is for.
+
+constexpr static const int ELEM_COUNT = 1000000;
+
+static_assert(sizeof(function_ref<bool(int, int)>) == 2 * sizeof(void*),
+    "function_ref is meant to be two words");
+static_assert(std::is_trivially_copyable<function_ref<bool(int, int)>>::value,
+    "function_ref is meant to be trivially copyable");
+
+static const std::vector<int>& input()
+{
+  static const std::vector<int> v = [] {
+    std::vector<int> r(ELEM_COUNT);
+    std::mt19937 gen(42);
+    std::generate(r.begin(), r.end(), gen);
+    return r;
+  }();
+  return v;
+}
+
+template <typename Compare>
+[[gnu::noinline]] void sort_with(std::vector<int>& v, Compare cmp)
+{
+  std::sort(v.begin(), v.end(),
+      [&cmp](int a, int b) { return cmp(a, b); });
+}
+
+template <typename Compare>
+static void BM_sort_with(benchmark::State& state)
+{
+  volatile int key = 0x5a5a;
+  auto cmp = [&key](int a, int b) { return (a ^ key) < (b ^ key); };
+  std::vector<int> v;
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    v = input();
+    state.ResumeTiming();
+    sort_with<Compare>(v, cmp);
+  }
+  state.SetItemsProcessed(state.iterations() * ELEM_COUNT);
+}
+
+static void BM_sort_direct_lambda(benchmark::State& state)
+{
+  volatile int key = 0x5a5a;
+  auto cmp = [&key](int a, int b) { return (a ^ key) < (b ^ key); };
+  std::vector<int> v;
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    v = input();
+    state.ResumeTiming();
+    sort_with(v, cmp);
+  }
+  state.SetItemsProcessed(state.iterations() * ELEM_COUNT);
+}
+
+BENCHMARK(BM_sort_direct_lambda)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sort_with, function_ref<bool(int, int)>)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sort_with, Function<bool(int, int)>)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sort_with, delegate<bool(int, int)>)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sort_with, std::function<bool(int, int)>)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
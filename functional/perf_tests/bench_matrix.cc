@@ -0,0 +1,389 @@
+#include "benchmark/benchmark.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../impl_fast_delegate.hpp"
+#include "../my_function.hpp"
+#include "../fast_func.hpp"
+
+// One matrix over every callable wrapper in this directory:
+//
+//   operation / wrapper / capture size in bytes
+//
+// operations:  construct, copy, move, reassign, invoke_mono, invoke_mega
+// wrappers:    Function, delegate, FastFunc, std_function, virtual,
+//              direct (the lambda itself, no type erasure)
+// captures:    0 (captureless) to 256 bytes
+//
+// invoke_mono calls 1024 wrappers holding the same lambda type from one
+// call site, invoke_mega 1024 wrappers holding 8 lambda types in random
+// order. direct has no megamorphic variant.
+//
+// Unless --benchmark_out is given the results are also written as JSON
+// to bench_matrix_<platform>_<stdlib>_<compiler version>.json, named
+// like the result directories next to this file, for comparing runs of
+// different compilers with Google Benchmark's tools/compare.py.
+
+using Signature = int (int);
+
+/////////////////////////////
+// Functors
+/////////////////////////////
+
+// A lambda capturing exactly N bytes, distinct per Tag
+template <std::size_t N, int Tag>
+static auto make_functor(std::false_type)
+{
+  std::array<unsigned char, N> buf{};
+  buf[N - 1] = Tag;
+  return [buf](int v) { return v + buf[N - 1]; };
+}
+
+template <std::size_t N, int Tag>
+static auto make_functor(std::true_type)
+{
+  return [](int v) { return v + Tag; };
+}
+
+template <std::size_t N, int Tag = 0>
+static auto make_functor()
+{
+  return make_functor<N, Tag>(std::integral_constant<bool, N == 0>{});
+}
+
+template <std::size_t N>
+using functor_t = decltype(make_functor<N>());
+
+/////////////////////////////
+// Wrappers
+/////////////////////////////
+
+// The classic type erasure through a heap allocated virtual interface
+template <typename Signature> class virtual_function;
+
+template <typename R, typename... A>
+class virtual_function<R (A...)>
+{
+public:
+  template <typename F>
+  virtual_function(F f) : p_(new model<F>(std::move(f))) { }
+
+  virtual_function(const virtual_function& other) : p_(other.p_->clone()) { }
+  virtual_function(virtual_function&&) noexcept = default;
+
+  virtual_function& operator=(const virtual_function& other)
+  {
+    p_.reset(other.p_->clone());
+    return *this;
+  }
+
+  virtual_function& operator=(virtual_function&&) noexcept = default;
+
+  R operator()(A... args) const { return p_->call(std::forward<A>(args)...); }
+
+private:
+  struct concept_t
+  {
+    virtual ~concept_t() = default;
+    virtual R call(A...) = 0;
+    virtual concept_t* clone() const = 0;
+  };
+
+  template <typename F>
+  struct model : concept_t
+  {
+    explicit model(F f) : f_(std::move(f)) { }
+    R call(A... args) override { return f_(std::forward<A>(args)...); }
+    concept_t* clone() const override { return new model(f_); }
+    F f_;
+  };
+
+  std::unique_ptr<concept_t> p_;
+};
+
+// Each adapter names a wrapper and the type it uses for a functor F
+struct my_function_adapter
+{
+  static constexpr const char* name = "Function";
+  static constexpr bool erased = true;
+  template <typename F> using type = Function<Signature>;
+};
+
+struct delegate_adapter
+{
+  static constexpr const char* name = "delegate";
+  static constexpr bool erased = true;
+  template <typename F> using type = delegate<Signature>;
+};
+
+struct fast_func_adapter
+{
+  static constexpr const char* name = "FastFunc";
+  static constexpr bool erased = true;
+  template <typename F> using type = ssvu::FastFunc<Signature>;
+};
+
+struct std_function_adapter
+{
+  static constexpr const char* name = "std_function";
+  static constexpr bool erased = true;
+  template <typename F> using type = std::function<Signature>;
+};
+
+struct virtual_adapter
+{
+  static constexpr const char* name = "virtual";
+  static constexpr bool erased = true;
+  template <typename F> using type = virtual_function<Signature>;
+};
+
+struct direct_adapter
+{
+  static constexpr const char* name = "direct";
+  static constexpr bool erased = false;
+  template <typename F> using type = F;
+};
+
+// Lambdas are not assignable, so reassigning one means destroying it and
+// constructing the new one in place
+template <typename W, typename F>
+static void reassign(W& w, F&& f, std::true_type) { w = std::forward<F>(f); }
+
+template <typename W, typename F>
+static void reassign(W& w, F&& f, std::false_type)
+{
+  w.~W();
+  new (&w) W(std::forward<F>(f));
+}
+
+template <typename W, typename F>
+static void reassign(W& w, F&& f)
+{
+  reassign(w, std::forward<F>(f), std::is_assignable<W&, F&&>{});
+}
+
+/////////////////////////////
+// Operations
+/////////////////////////////
+
+template <typename Adapter, std::size_t N>
+using wrapper_t = typename Adapter::template type<functor_t<N>>;
+
+template <typename Adapter, std::size_t N>
+static void BM_construct(benchmark::State& state)
+{
+  auto f = make_functor<N>();
+  while (state.KeepRunning()) {
+    wrapper_t<Adapter, N> w(f);
+    benchmark::DoNotOptimize(&w);
+  }
+}
+
+template <typename Adapter, std::size_t N>
+static void BM_copy(benchmark::State& state)
+{
+  const wrapper_t<Adapter, N> w(make_functor<N>());
+  while (state.KeepRunning()) {
+    wrapper_t<Adapter, N> copy(w);
+    benchmark::DoNotOptimize(&copy);
+  }
+}
+
+// Moves back and forth between two slots: one move construction and
+// one destruction of the moved from wrapper per iteration
+template <typename Adapter, std::size_t N>
+static void BM_move(benchmark::State& state)
+{
+  using W = wrapper_t<Adapter, N>;
+  alignas(W) unsigned char slots[2][sizeof(W)];
+  W* w = new (slots[0]) W(make_functor<N>());
+  int i = 0;
+  while (state.KeepRunning()) {
+    i ^= 1;
+    W* moved = new (slots[i]) W(std::move(*w));
+    w->~W();
+    w = moved;
+    benchmark::DoNotOptimize(w);
+  }
+  w->~W();
+}
+
+template <typename Adapter, std::size_t N>
+static void BM_reassign(benchmark::State& state)
+{
+  auto f = make_functor<N>();
+  wrapper_t<Adapter, N> w(f);
+  while (state.KeepRunning()) {
+    reassign(w, f);
+    benchmark::DoNotOptimize(&w);
+  }
+}
+
+constexpr static const std::size_t CALL_SITE_SIZE = 1024;
+
+template <typename Adapter, std::size_t N>
+static void run_invoke(benchmark::State& state,
+  std::vector<wrapper_t<Adapter, N>>& ws)
+{
+  int v = 0;
+  while (state.KeepRunning()) {
+    for (auto& w: ws) v = w(v);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetItemsProcessed(state.iterations() * ws.size());
+}
+
+template <typename Adapter, std::size_t N>
+static void BM_invoke_mono(benchmark::State& state)
+{
+  std::vector<wrapper_t<Adapter, N>> ws(CALL_SITE_SIZE, make_functor<N>());
+  run_invoke<Adapter, N>(state, ws);
+}
+
+template <typename W, std::size_t N, int Tag>
+static W make_wrapper() { return W(make_functor<N, Tag>()); }
+
+template <typename Adapter, std::size_t N, int... Tag>
+static void run_invoke_mega(benchmark::State& state,
+  std::integer_sequence<int, Tag...>)
+{
+  using W = wrapper_t<Adapter, N>;
+  static const std::array<W (*)(), sizeof...(Tag)> makers{{
+    make_wrapper<W, N, Tag>...
+  }};
+  std::vector<W> ws;
+  ws.reserve(CALL_SITE_SIZE);
+  for (std::size_t i = 0; i < CALL_SITE_SIZE; ++i) {
+    ws.push_back(makers[i % makers.size()]());
+  }
+  std::shuffle(ws.begin(), ws.end(), std::mt19937(42));
+  run_invoke<Adapter, N>(state, ws);
+}
+
+template <typename Adapter, std::size_t N>
+static void BM_invoke_mega(benchmark::State& state)
+{
+  run_invoke_mega<Adapter, N>(state, std::make_integer_sequence<int, 8>{});
+}
+
+/////////////////////////////
+// Registration
+/////////////////////////////
+
+enum class operation
+{
+  construct, copy, move, reassign, invoke_mono, invoke_mega
+};
+
+constexpr static const char* operation_names[] = {
+  "construct", "copy", "move", "reassign", "invoke_mono", "invoke_mega"
+};
+
+template <std::size_t... N> struct capture_sizes { };
+
+using bench_fn = void (*)(benchmark::State&);
+
+template <typename Adapter, std::size_t N>
+static bench_fn invoke_mega_bench(std::true_type)
+{
+  return BM_invoke_mega<Adapter, N>;
+}
+
+template <typename Adapter, std::size_t N>
+static bench_fn invoke_mega_bench(std::false_type) { return nullptr; }
+
+template <typename Adapter, std::size_t N>
+static void register_one(operation op)
+{
+  static const bench_fn benches[] = {
+    BM_construct<Adapter, N>, BM_copy<Adapter, N>, BM_move<Adapter, N>,
+    BM_reassign<Adapter, N>, BM_invoke_mono<Adapter, N>,
+    invoke_mega_bench<Adapter, N>(
+      std::integral_constant<bool, Adapter::erased>{})
+  };
+  const auto i = static_cast<std::size_t>(op);
+  if (!benches[i]) return;
+
+  auto name = std::string(operation_names[i]) + "/" + Adapter::name + "/" +
+    std::to_string(N);
+  benchmark::RegisterBenchmark(name.c_str(), benches[i]);
+}
+
+template <typename Adapter, std::size_t... N>
+static void register_wrapper(operation op, capture_sizes<N...>)
+{
+  int expand[] = { (register_one<Adapter, N>(op), 0)... };
+  (void) expand;
+}
+
+template <typename... Adapter>
+static void register_matrix()
+{
+  using sizes = capture_sizes<0, 8, 16, 32, 64, 128, 256>;
+  for (auto op: { operation::construct, operation::copy, operation::move,
+    operation::reassign, operation::invoke_mono, operation::invoke_mega }) {
+    int expand[] = { (register_wrapper<Adapter>(op, sizes{}), 0)... };
+    (void) expand;
+  }
+}
+
+// Same scheme as the result directories, e.g. linux_libstd++_6.2
+static std::string platform_id()
+{
+#if defined(__APPLE__)
+  std::string id = "mac";
+#elif defined(__linux__)
+  std::string id = "linux";
+#else
+  std::string id = "other";
+#endif
+
+#if defined(_LIBCPP_VERSION)
+  id += "_libc++";
+#elif defined(__GLIBCXX__)
+# if defined(__clang__)
+  id += "_clang";
+# endif
+  id += "_libstd++";
+#endif
+
+#if defined(__clang__)
+  id += "_" + std::to_string(__clang_major__) + "." +
+    std::to_string(__clang_minor__);
+#elif defined(__GNUC__)
+  id += "_" + std::to_string(__GNUC__) + "." + std::to_string(__GNUC_MINOR__);
+#endif
+  return id;
+}
+
+int main(int argc, char** argv)
+{
+  // Default to a JSON file per platform unless told otherwise
+  std::vector<char*> args(argv, argv + argc);
+  const bool has_out = std::any_of(args.begin() + 1, args.end(),
+    [](const char* a) { return std::strncmp(a, "--benchmark_out=", 16) == 0; });
+  std::string out = "--benchmark_out=bench_matrix_" + platform_id() + ".json";
+  std::string format = "--benchmark_out_format=json";
+  if (!has_out) {
+    args.push_back(&out[0]);
+    args.push_back(&format[0]);
+  }
+  int count = static_cast<int>(args.size());
+
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 1;
+  benchmark::AddCustomContext("platform", platform_id());
+
+  register_matrix<my_function_adapter, delegate_adapter, fast_func_adapter,
+    std_function_adapter, virtual_adapter, direct_adapter>();
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
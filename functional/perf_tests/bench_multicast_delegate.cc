@@ -0,0 +1,113 @@
+#include "benchmark/benchmark.h"
+#include <functional>
+#include <vector>
+#include "../multicast_delegate.hpp"
+
+// Emitting one event to 1 .. 4096 subscribers, each one updating
+// its own object.
+
+struct Subscriber
+{
+  void on_event(int v) { sum_ += v; }
+
+  long sum_ = 0;
+};
+
+using Event = void(int);
+
+static void BM_vector_std_function_emit(benchmark::State& state)
+{
+  std::vector<Subscriber> subs(state.range(0));
+  std::vector<std::function<Event>> handlers;
+  for (auto& s: subs) {
+    handlers.emplace_back([&s](int v) { s.on_event(v); });
+  }
+  int v = 0;
+  while (state.KeepRunning()) {
+    for (auto& h: handlers) h(v);
+    ++v;
+  }
+  benchmark::DoNotOptimize(subs.data());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_vector_delegate_emit(benchmark::State& state)
+{
+  std::vector<Subscriber> subs(state.range(0));
+  std::vector<delegate<Event>> handlers;
+  for (auto& s: subs) {
+    handlers.push_back(
+        delegate<Event>::from<Subscriber, &Subscriber::on_event>(s));
+  }
+  int v = 0;
+  while (state.KeepRunning()) {
+    for (auto& h: handlers) h(v);
+    ++v;
+  }
+  benchmark::DoNotOptimize(subs.data());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_multicast_delegate_emit(benchmark::State& state)
+{
+  std::vector<Subscriber> subs(state.range(0));
+  multicast_delegate<Event> event;
+  for (auto& s: subs) {
+    event.connect(delegate<Event>::from<Subscriber, &Subscriber::on_event>(s));
+  }
+  int v = 0;
+  while (state.KeepRunning()) {
+    event(v);
+    ++v;
+  }
+  benchmark::DoNotOptimize(subs.data());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Same, with the subscribers bound through lambdas owned by the
+// multicast_delegate
+static void BM_multicast_delegate_emit_owned(benchmark::State& state)
+{
+  std::vector<Subscriber> subs(state.range(0));
+  multicast_delegate<Event> event;
+  for (auto& s: subs) {
+    event.connect([&s](int v) { s.on_event(v); });
+  }
+  int v = 0;
+  while (state.KeepRunning()) {
+    event(v);
+    ++v;
+  }
+  benchmark::DoNotOptimize(subs.data());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Connect and disconnect churn at a steady subscriber count
+static void BM_multicast_delegate_connect_disconnect(benchmark::State& state)
+{
+  std::vector<Subscriber> subs(state.range(0));
+  multicast_delegate<Event> event;
+  std::vector<multicast_delegate<Event>::connection> connections;
+  for (auto& s: subs) {
+    connections.push_back(event.connect(
+        delegate<Event>::from<Subscriber, &Subscriber::on_event>(s)));
+  }
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    event.disconnect(connections[i]);
+    connections[i] = event.connect(
+        delegate<Event>::from<Subscriber, &Subscriber::on_event>(subs[i]));
+    if (++i == connections.size()) i = 0;
+  }
+}
+
+#define BENCHMARK_SUBSCRIBERS(bm) \
+  BENCHMARK(bm)->Arg(1)->Arg(16)->Arg(256)->Arg(4096)
+
+BENCHMARK_SUBSCRIBERS(BM_vector_std_function_emit);
+BENCHMARK_SUBSCRIBERS(BM_vector_delegate_emit);
+BENCHMARK_SUBSCRIBERS(BM_multicast_delegate_emit);
+BENCHMARK_SUBSCRIBERS(BM_multicast_delegate_emit_owned);
+BENCHMARK_SUBSCRIBERS(BM_multicast_delegate_connect_disconnect);
+
+BENCHMARK_MAIN();
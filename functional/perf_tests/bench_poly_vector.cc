@@ -0,0 +1,119 @@
+#include "benchmark/benchmark.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../poly_vector.hpp"
+#include "perf_counter.hpp"
+
+// The perf_vf.cc workload: one handle_event call on each of 1M
+// alternating DataHandler and AcceptHandler objects, stored as
+// unique_ptrs and stored inline in a poly_vector.
+//
+// The unique_ptr layout is run twice: Arg 0 walks the handlers in
+// allocation order like perf_vf.cc, Arg 1 in a random order, which is
+// where a long running process ends up once connections have come and
+// gone and the allocator has reused the holes.
+
+class EventHandler
+{
+public:
+  virtual void handle_event(void* user_ctx) = 0;
+  virtual ~EventHandler() = default;
+};
+
+class AcceptHandler final: public EventHandler
+{
+public:
+  AcceptHandler() {}
+  void handle_event(void* uctx)
+  {
+    (void) uctx;
+  }
+
+private:
+  int fd_ = -1;
+};
+
+struct Ctx { volatile int di; };
+
+class DataHandler final: public EventHandler
+{
+public:
+  DataHandler(int fd): fd_(fd) {}
+  void handle_event(void* uctx)
+  {
+    auto ctx_ptr = static_cast<Ctx*>(uctx);
+    ctx_ptr->di++;
+  }
+private:
+  int fd_ = -1;
+};
+
+constexpr static const int ITER_COUNT = 1000000;
+
+template <typename Handlers, typename Handle>
+static void run_handlers(benchmark::State& state, Handlers& evhs,
+  Handle handle)
+{
+  auto ctx_ptr(std::make_unique<Ctx>());
+
+  perf_counter misses(perf_counter::event::cache_misses);
+  misses.start();
+  while (state.KeepRunning()) {
+    for (auto& eh : evhs) {
+      handle(eh, ctx_ptr.get());
+    }
+  }
+  misses.stop();
+
+  state.counters["time/event"] = benchmark::Counter(ITER_COUNT,
+      benchmark::Counter::kIsIterationInvariantRate |
+      benchmark::Counter::kInvert);
+  if (misses.valid()) {
+    state.counters["cache_misses/event"] = benchmark::Counter(
+        static_cast<double>(misses.value()) / ITER_COUNT,
+        benchmark::Counter::kAvgIterations);
+  }
+}
+
+static void BM_unique_ptr_handlers(benchmark::State& state)
+{
+  std::vector<std::unique_ptr<EventHandler>> evhs;
+  evhs.reserve(ITER_COUNT);
+
+  for (int i = 0; i < ITER_COUNT; ++i) {
+    if (i % 2 == 0) evhs.emplace_back(std::make_unique<DataHandler>(i));
+    else evhs.emplace_back(std::make_unique<AcceptHandler>());
+  }
+  if (state.range(0)) {
+    std::shuffle(evhs.begin(), evhs.end(), std::mt19937(42));
+  }
+
+  run_handlers(state, evhs, [](std::unique_ptr<EventHandler>& eh, Ctx* ctx) {
+    eh->handle_event(ctx);
+  });
+}
+
+static void BM_poly_vector_handlers(benchmark::State& state)
+{
+  poly_vector<EventHandler> evhs;
+  evhs.reserve(ITER_COUNT * 40);
+
+  for (int i = 0; i < ITER_COUNT; ++i) {
+    if (i % 2 == 0) evhs.emplace<DataHandler>(i);
+    else evhs.emplace<AcceptHandler>();
+  }
+
+  run_handlers(state, evhs, [](EventHandler& eh, Ctx* ctx) {
+    eh.handle_event(ctx);
+  });
+  // Buffer plus the array of header offsets
+  state.counters["bytes/handler"] = static_cast<double>(evhs.bytes()) /
+    ITER_COUNT + sizeof(std::size_t);
+}
+
+BENCHMARK(BM_unique_ptr_handlers)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_poly_vector_handlers)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
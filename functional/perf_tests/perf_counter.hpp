@@ -0,0 +1,217 @@
+#pragma once
+#ifndef PERF_COUNTER_HPP
+# define PERF_COUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+// Counts a hardware event in user space for the calling thread, through
+// perf_event_open. Where that is not available (not Linux, no PMU in a
+// VM or container, perf_event_paranoid too high) valid() is false,
+// value() stays 0, and benchmarks leave the counter out of their report.
+
+class perf_counter
+{
+public:
+  enum class event
+  {
+    branch_misses,
+    cache_misses, // last level cache
+    cycles,
+    instructions,
+    l1i_misses,   // reads
+    l1d_misses,   // reads
+  };
+
+  explicit perf_counter(event e) : fd_(open(e, -1, 0)) {}
+
+  perf_counter(const perf_counter&) = delete;
+  perf_counter& operator=(const perf_counter&) = delete;
+
+  ~perf_counter()
+  {
+#ifdef __linux__
+    if (valid()) close(fd_);
+#endif
+  }
+
+  bool valid() const noexcept { return fd_ >= 0; }
+
+  void start() noexcept
+  {
+#ifdef __linux__
+    if (valid()) ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  void stop() noexcept
+  {
+#ifdef __linux__
+    if (valid()) ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+  }
+
+  // Total counted between all start/stop pairs so far
+  std::uint64_t value() const noexcept
+  {
+    std::uint64_t n = 0;
+#ifdef __linux__
+    if (valid() && read(fd_, &n, sizeof(n)) != sizeof(n)) n = 0;
+#endif
+    return n;
+  }
+
+private:
+  friend class perf_counter_group;
+
+  // Starts disabled when it leads a group (or has none), -1 on failure
+  static int open(event e, int group_fd, std::uint64_t read_format) noexcept
+  {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    configure(e, attr);
+    attr.read_format = read_format;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+#else
+    (void) e; (void) group_fd; (void) read_format;
+    return -1;
+#endif
+  }
+
+#ifdef __linux__
+  static void configure(event e, perf_event_attr& attr) noexcept
+  {
+    constexpr std::uint64_t read_miss =
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (e) {
+    case event::branch_misses:
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case event::cache_misses:
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case event::cycles:
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case event::instructions:
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case event::l1i_misses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1I | read_miss;
+      break;
+    case event::l1d_misses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+      break;
+    }
+  }
+#endif
+
+  int fd_ = -1;
+};
+
+// Several events counted over the same stretch of code. They are put
+// on the PMU together, so ratios such as instructions per cycle compare
+// like with like. Events the CPU does not have are left out and the
+// rest still count. When the PMU has too few counters for the group,
+// the kernel time-shares it and the totals are scaled up accordingly.
+class perf_counter_group
+{
+public:
+  explicit perf_counter_group(std::initializer_list<perf_counter::event> events)
+  {
+#ifdef __linux__
+    const std::uint64_t read_format = PERF_FORMAT_GROUP |
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+#else
+    const std::uint64_t read_format = 0;
+#endif
+    for (auto e : events) {
+      int fd = perf_counter::open(e, leader_, read_format);
+      if (leader_ < 0) leader_ = fd;
+      fds_.push_back(fd);
+    }
+  }
+
+  perf_counter_group(const perf_counter_group&) = delete;
+  perf_counter_group& operator=(const perf_counter_group&) = delete;
+
+  ~perf_counter_group()
+  {
+#ifdef __linux__
+    for (int fd : fds_) {
+      if (fd >= 0) close(fd);
+    }
+#endif
+  }
+
+  bool valid() const noexcept { return leader_ >= 0; }
+
+  // Whether the i-th event given to the constructor is counted
+  bool valid(std::size_t i) const noexcept { return fds_[i] >= 0; }
+
+  void start() noexcept
+  {
+#ifdef __linux__
+    if (valid()) ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  void stop() noexcept
+  {
+#ifdef __linux__
+    if (valid()) ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  // Totals between all start/stop pairs so far, in the order the events
+  // were given, 0 for those not counted. Empty when nothing was counted.
+  std::vector<std::uint64_t> values() const
+  {
+    std::vector<std::uint64_t> totals;
+#ifdef __linux__
+    if (!valid()) return totals;
+
+    // nr, time enabled, time running, then one value per open event
+    std::vector<std::uint64_t> buf(3 + fds_.size());
+    const auto size = buf.size() * sizeof(buf[0]);
+    if (read(leader_, buf.data(), size) <= 0 || 3 + buf[0] > buf.size() ||
+        !buf[2]) {
+      return totals;
+    }
+
+    const double scale = static_cast<double>(buf[1]) / buf[2];
+    std::size_t next = 3;
+    for (int fd : fds_) {
+      totals.push_back(fd < 0 ? 0 :
+        static_cast<std::uint64_t>(static_cast<double>(buf[next++]) * scale));
+    }
+#endif
+    return totals;
+  }
+
+private:
+  std::vector<int> fds_;
+  int leader_ = -1;
+};
+
+#endif // PERF_COUNTER_HPP
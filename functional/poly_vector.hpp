@@ -0,0 +1,521 @@
+#pragma once
+#ifndef POLY_VECTOR_HPP
+# define POLY_VECTOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A sequence of objects derived from Base, stored by value one after the
+// other in a single buffer instead of as separately allocated nodes.
+//
+//   poly_vector<EventHandler> handlers;
+//   auto const i(handlers.emplace<DataHandler>(fd));
+//   for (auto& h: handlers) h.handle_event(ctx);
+//   handlers.erase(i);
+//
+// Each object is preceded by a small header holding its type operations,
+// its index and the distance to the next header. A separate array holds
+// the header offsets, so iterating walks two arrays front to back.
+// Objects are visited in the order they were emplaced.
+//
+// emplace returns an index that stays valid until the object is erased,
+// after which it may be handed out again. Erasing destroys the object
+// and leaves a hole. Once holes take up half the buffer, the live
+// objects are moved into a new buffer without them. The same happens
+// when the buffer grows. Either invalidates references and iterators,
+// but never indices.
+//
+// Derived types must be nothrow move constructible and not over aligned.
+
+template <class Base>
+class poly_vector
+{
+  struct type_ops
+  {
+    // Move constructs the object at to and destroys the one at from
+    void (*relocate)(void* from, void* to) noexcept;
+    void (*destroy)(void*) noexcept;
+    ::std::size_t size;
+    ::std::size_t align;
+  };
+
+  struct header
+  {
+    type_ops const* ops; // null once erased
+    ::std::uint32_t index;
+    ::std::uint32_t next; // bytes from this header to the next one
+    ::std::uint32_t object; // bytes from this header to the object
+    ::std::uint32_t base; // bytes from this header to the Base subobject
+  };
+
+  template <class B>
+  class basic_iterator
+  {
+    friend class poly_vector;
+
+  public:
+    using iterator_category = ::std::forward_iterator_tag;
+    using value_type = typename ::std::remove_const<B>::type;
+    using difference_type = ::std::ptrdiff_t;
+    using pointer = B*;
+    using reference = B&;
+
+    basic_iterator() = default;
+
+    // iterator converts to const_iterator
+    template <class C, typename = typename ::std::enable_if<
+      ::std::is_const<B>{} && !::std::is_const<C>{}>::type>
+    basic_iterator(basic_iterator<C> const& other) noexcept :
+      buffer_(other.buffer_),
+      p_(other.p_),
+      end_(other.end_)
+    {
+    }
+
+    reference operator*() const noexcept
+    {
+      return *object(reinterpret_cast<header*>(buffer_ + *p_));
+    }
+
+    pointer operator->() const noexcept { return &**this; }
+
+    basic_iterator& operator++() noexcept
+    {
+      ++p_;
+
+      skip_erased();
+
+      return *this;
+    }
+
+    basic_iterator operator++(int) noexcept
+    {
+      auto const tmp(*this);
+
+      ++*this;
+
+      return tmp;
+    }
+
+    bool operator==(basic_iterator const& rhs) const noexcept
+    {
+      return p_ == rhs.p_;
+    }
+
+    bool operator!=(basic_iterator const& rhs) const noexcept
+    {
+      return !operator==(rhs);
+    }
+
+  private:
+    basic_iterator(unsigned char* const buffer, ::std::size_t const* const p,
+      ::std::size_t const* const end) noexcept :
+      buffer_(buffer),
+      p_(p),
+      end_(end)
+    {
+      skip_erased();
+    }
+
+    void skip_erased() noexcept
+    {
+      while ((p_ != end_) &&
+        !reinterpret_cast<header const*>(buffer_ + *p_)->ops)
+      {
+        ++p_;
+      }
+    }
+
+    unsigned char* buffer_{};
+    ::std::size_t const* p_{};
+    ::std::size_t const* end_{};
+  };
+
+public:
+  using size_type = ::std::size_t;
+  using iterator = basic_iterator<Base>;
+  using const_iterator = basic_iterator<Base const>;
+
+  poly_vector() = default;
+
+  poly_vector(poly_vector const&) = delete;
+
+  poly_vector(poly_vector&& other) noexcept { swap(other); }
+
+  ~poly_vector()
+  {
+    clear();
+
+    ::operator delete(buffer_);
+  }
+
+  poly_vector& operator=(poly_vector const&) = delete;
+
+  poly_vector& operator=(poly_vector&& rhs) noexcept
+  {
+    poly_vector(::std::move(rhs)).swap(*this);
+
+    return *this;
+  }
+
+  void swap(poly_vector& other) noexcept
+  {
+    ::std::swap(buffer_, other.buffer_);
+    ::std::swap(capacity_, other.capacity_);
+    ::std::swap(end_, other.end_);
+    ::std::swap(erased_bytes_, other.erased_bytes_);
+    ::std::swap(size_, other.size_);
+    order_.swap(other.order_);
+    offsets_.swap(other.offsets_);
+    free_indices_.swap(other.free_indices_);
+  }
+
+  template <class T, class ...A>
+  size_type emplace(A&& ...args)
+  {
+    static_assert(::std::is_base_of<Base, T>{}, "T must derive from Base");
+    static_assert(alignof(T) <= alignof(::std::max_align_t),
+      "over aligned types are not supported");
+    static_assert(::std::is_nothrow_move_constructible<T>{},
+      "T must be nothrow move constructible");
+
+    auto const& ops(ops_of<T>());
+
+    if (capacity_ - end_ < stride(end_, ops))
+    {
+      rebuild(::std::max(2 * capacity_, relocated_bytes() +
+        sizeof(header) + ops.size + ops.align + alignof(header)));
+    }
+
+    order_.push_back(end_);
+
+    size_type index;
+
+    try
+    {
+      index = acquire_index();
+    }
+    catch (...)
+    {
+      order_.pop_back();
+
+      throw;
+    }
+
+    auto const h(buffer_ + end_);
+    auto const object(object_offset(end_, ops.align));
+
+    T* p;
+
+    try
+    {
+      p = ::new (static_cast<void*>(h + object)) T(::std::forward<A>(args)...);
+    }
+    catch (...)
+    {
+      release_index(index);
+      order_.pop_back();
+
+      throw;
+    }
+
+    ::new (static_cast<void*>(h)) header{&ops,
+      static_cast<::std::uint32_t>(index),
+      static_cast<::std::uint32_t>(stride(end_, ops)),
+      static_cast<::std::uint32_t>(object),
+      static_cast<::std::uint32_t>(reinterpret_cast<unsigned char*>(
+        static_cast<Base*>(p)) - h)};
+
+    offsets_[index] = end_;
+    end_ += reinterpret_cast<header*>(h)->next;
+    ++size_;
+
+    return index;
+  }
+
+  void erase(size_type const index) noexcept
+  {
+    auto const h(header_at(index));
+
+    h->ops->destroy(reinterpret_cast<unsigned char*>(h) + h->object);
+    h->ops = nullptr;
+
+    erased_bytes_ += h->next;
+    --size_;
+
+    release_index(index);
+
+    if (2 * erased_bytes_ > end_)
+    {
+      compact();
+    }
+  }
+
+  // Moves the live objects into a buffer without holes
+  void compact() noexcept
+  {
+    if (erased_bytes_)
+    {
+      rebuild_nothrow(::std::max(capacity_, relocated_bytes()));
+    }
+  }
+
+  // Makes room for at least n bytes of objects and headers
+  void reserve(size_type const bytes)
+  {
+    if (bytes > capacity_)
+    {
+      rebuild(bytes);
+    }
+  }
+
+  void clear() noexcept
+  {
+    for (auto p(buffer_), end(buffer_ + end_); p != end;
+      p += reinterpret_cast<header*>(p)->next)
+    {
+      auto const h(reinterpret_cast<header*>(p));
+
+      if (h->ops)
+      {
+        h->ops->destroy(p + h->object);
+      }
+    }
+
+    end_ = erased_bytes_ = size_ = 0;
+    order_.clear();
+    offsets_.clear();
+    free_indices_.clear();
+  }
+
+  Base& operator[](size_type const index) noexcept
+  {
+    return *object(header_at(index));
+  }
+
+  Base const& operator[](size_type const index) const noexcept
+  {
+    return *object(header_at(index));
+  }
+
+  size_type size() const noexcept { return size_; }
+
+  bool empty() const noexcept { return !size_; }
+
+  // Bytes taken by objects, headers and holes
+  size_type bytes() const noexcept { return end_; }
+
+  size_type capacity() const noexcept { return capacity_; }
+
+  iterator begin() noexcept
+  {
+    return {buffer_, order_.data(), order_.data() + order_.size()};
+  }
+
+  iterator end() noexcept
+  {
+    auto const end(order_.data() + order_.size());
+
+    return {buffer_, end, end};
+  }
+
+  const_iterator begin() const noexcept
+  {
+    return {buffer_, order_.data(), order_.data() + order_.size()};
+  }
+
+  const_iterator end() const noexcept
+  {
+    auto const end(order_.data() + order_.size());
+
+    return {buffer_, end, end};
+  }
+
+private:
+  static constexpr auto npos = ::std::numeric_limits<size_type>::max();
+
+  template <class T>
+  static type_ops const& ops_of() noexcept
+  {
+    static type_ops const ops{
+      [](void* const from, void* const to) noexcept
+      {
+        auto const p(static_cast<T*>(from));
+
+        ::new (to) T(::std::move(*p));
+
+        p->~T();
+      },
+      [](void* const p) noexcept { static_cast<T*>(p)->~T(); },
+      sizeof(T),
+      alignof(T)
+    };
+
+    return ops;
+  }
+
+  static size_type align_up(size_type const n, size_type const a) noexcept
+  {
+    return (n + a - 1) & ~(a - 1);
+  }
+
+  // The buffer is max_align_t aligned, so offsets within it can be
+  // aligned instead of addresses
+  static size_type object_offset(size_type const at,
+    size_type const align) noexcept
+  {
+    return align_up(at + sizeof(header), align) - at;
+  }
+
+  static size_type stride(size_type const at, type_ops const& ops) noexcept
+  {
+    return align_up(object_offset(at, ops.align) + ops.size, alignof(header));
+  }
+
+  template <class H>
+  static auto object(H* const h) noexcept
+  {
+    using B = typename ::std::conditional<::std::is_const<H>{},
+      Base const, Base>::type;
+    using byte = typename ::std::conditional<::std::is_const<H>{},
+      unsigned char const, unsigned char>::type;
+
+    return reinterpret_cast<B*>(reinterpret_cast<byte*>(h) + h->base);
+  }
+
+  // At most what the live objects take once relocated, as their
+  // alignment padding may grow at their new offsets
+  size_type relocated_bytes() const noexcept
+  {
+    return end_ - erased_bytes_ +
+      size_ * (alignof(::std::max_align_t) - alignof(header));
+  }
+
+  header* header_at(size_type const index) const noexcept
+  {
+    assert(index < offsets_.size());
+    assert(offsets_[index] != npos);
+
+    return reinterpret_cast<header*>(buffer_ + offsets_[index]);
+  }
+
+  // Every new index gets room in free_indices_, so that releasing it
+  // later never allocates
+  size_type acquire_index()
+  {
+    if (free_indices_.empty())
+    {
+      if (free_indices_.capacity() <= offsets_.size())
+      {
+        free_indices_.reserve(::std::max(2 * free_indices_.capacity(),
+          offsets_.size() + 1));
+      }
+
+      offsets_.push_back(npos);
+
+      return offsets_.size() - 1;
+    }
+    else
+    {
+      auto const index(free_indices_.back());
+
+      free_indices_.pop_back();
+
+      return index;
+    }
+  }
+
+  void release_index(size_type const index) noexcept
+  {
+    offsets_[index] = npos;
+
+    assert(free_indices_.size() < free_indices_.capacity());
+
+    free_indices_.push_back(index);
+  }
+
+  void rebuild(size_type const capacity)
+  {
+    auto const buffer(static_cast<unsigned char*>(::operator new(capacity)));
+
+    relocate_into(buffer, capacity);
+  }
+
+  // Keeps the holes if there is no memory for a new buffer
+  void rebuild_nothrow(size_type const capacity) noexcept
+  {
+    auto const buffer(static_cast<unsigned char*>(
+      ::operator new(capacity, ::std::nothrow)));
+
+    if (buffer)
+    {
+      relocate_into(buffer, capacity);
+    }
+  }
+
+  void relocate_into(unsigned char* const buffer,
+    size_type const capacity) noexcept
+  {
+    size_type to{};
+    size_type live{};
+
+    for (auto p(buffer_), end(buffer_ + end_); p != end;
+      p += reinterpret_cast<header*>(p)->next)
+    {
+      auto const h(reinterpret_cast<header*>(p));
+
+      if (!h->ops)
+      {
+        continue;
+      }
+
+      auto const object(object_offset(to, h->ops->align));
+
+      h->ops->relocate(p + h->object, buffer + to + object);
+
+      ::new (static_cast<void*>(buffer + to)) header{h->ops, h->index,
+        static_cast<::std::uint32_t>(stride(to, *h->ops)),
+        static_cast<::std::uint32_t>(object),
+        static_cast<::std::uint32_t>(object + (h->base - h->object))};
+
+      offsets_[h->index] = order_[live++] = to;
+      to += reinterpret_cast<header*>(buffer + to)->next;
+    }
+
+    order_.resize(live);
+
+    ::operator delete(buffer_);
+
+    buffer_ = buffer;
+    capacity_ = capacity;
+    end_ = to;
+    erased_bytes_ = 0;
+  }
+
+  unsigned char* buffer_{};
+  size_type capacity_{};
+  size_type end_{};
+  size_type erased_bytes_{};
+  size_type size_{};
+
+  // Header offsets in buffer order, erased ones included, so that
+  // iterating does not wait on each header to find the next
+  ::std::vector<size_type> order_;
+
+  // index -> offset of its header, npos once erased
+  ::std::vector<size_type> offsets_;
+  ::std::vector<size_type> free_indices_;
+};
+
+template <class Base>
+constexpr typename poly_vector<Base>::size_type poly_vector<Base>::npos;
+
+#endif // POLY_VECTOR_HPP